@@ -12,8 +12,26 @@
 #define READOUTMODULES_INCLUDE_READOUTMODULES_DATALINKHANDLERBASE_HPP_
 
 #include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/concepts/BatchedInputReadoutConcept.hpp"
+#include "readoutmodules/concepts/InstrumentedReadoutConcept.hpp"
+#include "readoutmodules/concepts/LossReportingReadoutConcept.hpp"
+#include "readoutmodules/concepts/PrefaultableReadoutConcept.hpp"
+#include "readoutmodules/concepts/RecordingReadoutConcept.hpp"
+#include "readoutmodules/concepts/RingInputReadoutConcept.hpp"
+#include "readoutmodules/datalinkhandlerconfig/Nljs.hpp"
+#include "readoutmodules/kernelinfo/InfoNljs.hpp"
+#include "readoutmodules/latencyinfo/InfoNljs.hpp"
+#include "readoutmodules/recordinginfo/InfoNljs.hpp"
+#include "readoutmodules/startupinfo/InfoNljs.hpp"
+#include "readoutmodules/utils/FrameBatch.hpp"
+#include "readoutmodules/utils/InProcessRing.hpp"
+#include "readoutmodules/utils/LinkLossRegistry.hpp"
+#include "readoutmodules/utils/MemoryPrefault.hpp"
+#include "readoutmodules/utils/SimdLevel.hpp"
 #include "readoutlibs/concepts/ReadoutConcept.hpp"
+#include "readoutlibs/readoutconfig/Nljs.hpp"
 #include "readoutlibs/ReadoutLogging.hpp"
+#include "appfwk/app/Nljs.hpp"
 #include "daqdataformats/Types.hpp"
 #include "logging/Logging.hpp"
 
@@ -22,6 +40,7 @@
 
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -58,10 +77,30 @@ public:
 
   std::string get_dlh_name() { return m_name; }
 
+protected:
+  //! Elements per queue pop, for create_readout to pick the batch type (see make_batched)
+  std::size_t get_batch_size() const { return m_ext_cfg.batch_size; }
+
 private:
+  // Publish the percentiles of one hot path stage and start a new interval
+  void add_latency_info(opmonlib::InfoCollector& ci, const std::string& stage, LatencyHistogram& histogram);
+  // Uid of the raw input connection, which names its in-process ring
+  std::string get_raw_input_uid() const;
+  // Refuse batches the readout would not unpack
+  void check_batched_input();
+  // Detach everything from the readout and destroy it, after scrap or a failed conf
+  void release_readout();
+  // Fault the latency buffer in, if the readout exposes it
+  void prefault_latency_buffer();
+  // Create the recording pipeline and hand it to the readout
+  void open_recorder();
+  // Publish the recording counters and rates since the last call
+  void add_recording_info(opmonlib::InfoCollector& ci);
 
   // Configuration
   bool m_configured;
+  nlohmann::json m_init_args;
+  datalinkhandlerconfig::Conf m_ext_cfg;
   daqdataformats::run_number_t m_run_number;
 
   // Name
@@ -69,9 +108,23 @@ private:
 
   // Internal
   std::unique_ptr<readoutlibs::ReadoutConcept> m_readout_impl;
+  InstrumentedReadoutConcept* m_instrumented_impl;
+  RingInputReadoutConcept* m_ring_input_impl;
+  RecordingReadoutConcept* m_recording_impl;
+  LossReportingReadoutConcept* m_loss_reporting_impl;
+
+  // Raw recording pipeline, when it replaces the recorder of the readout
+  std::unique_ptr<RawRecorder> m_recorder;
+  RawRecorderStats m_last_recording_stats;
+  std::chrono::steady_clock::time_point m_last_recording_info;
+
+  // Time to ready
+  startupinfo::Info m_startup_info;
 
   // Threading
   std::atomic<bool> m_run_marker;
+  // Held by the commands, so that get_info never sees the readout being created or destroyed
+  std::mutex m_command_mutex;
 };
 
 } // namespace readoutmodules
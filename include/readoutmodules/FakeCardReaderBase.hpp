@@ -13,20 +13,33 @@
 #define READOUTMODULES_INCLUDE_READOUTMODULES_FAKECARDREADERBASE_HPP_
 
 // package
+#include "readoutmodules/concepts/SourceEmulatorLinkConcept.hpp"
+#include "readoutmodules/fakecardreaderconfig/Nljs.hpp"
+#include "readoutmodules/ratesearchinfo/InfoNljs.hpp"
+#include "readoutmodules/startupinfo/InfoNljs.hpp"
+#include "readoutmodules/utils/FrameBatch.hpp"
+#include "readoutmodules/utils/MappedSourceBuffer.hpp"
+#include "readoutmodules/utils/MultiplexedEmulatorEngine.hpp"
+#include "readoutmodules/utils/ParallelFor.hpp"
+#include "readoutmodules/utils/ReplayClock.hpp"
+#include "readoutmodules/utils/SaturationRateFinder.hpp"
+
 #include "readoutlibs/concepts/SourceEmulatorConcept.hpp"
 #include "readoutlibs/sourceemulatorconfig/Structs.hpp"
 #include "readoutlibs/sourceemulatorconfig/Nljs.hpp"
 #include "readoutlibs/utils/ReusableThread.hpp"
-#include "readoutlibs/utils/FileSourceBuffer.hpp"
 
 #include "nlohmann/json.hpp"
 #include "rcif/cmd/Nljs.hpp"
 
 // std
+#include <chrono>
 #include <cstdint>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -63,20 +76,53 @@ public:
 
   std::string get_fcr_name() { return m_name; }
 
+protected:
+  //! Elements per queue push, for create_source_emulator to pick the batch type (see make_batched)
+  std::size_t get_batch_size() const { return m_ext_cfg.batch_size; }
+
 private:
+  // Create the emulators of all connections with create_source_emulator
+  void create_source_emulators();
+  // Create, bind and configure the emulators and what drives them
+  void conf_source_emulators(const nlohmann::json& args);
+  // Drop the emulators and what drives them, after scrap or a failed conf
+  void release_source_emulators();
+
+  // Set up the search of the highest lossless rate of every link
+  void create_rate_finder();
+  // Publish the state of the rate search, as a whole and per link
+  void add_rate_search_info(opmonlib::InfoCollector& ci);
+
+  // Map the source files not mapped yet, in parallel
+  void map_source_buffers(const std::set<std::string>& filenames, std::size_t threads);
+  // Map each distinct source file once, shared by every emulator reading it
+  std::shared_ptr<const MappedSourceBuffer> get_source_buffer(const std::string& filename);
+
   // Configuration
   bool m_configured;
   std::string m_name;
   using module_conf_t = readoutlibs::sourceemulatorconfig::Conf;
   module_conf_t m_cfg;
+  using ext_conf_t = fakecardreaderconfig::Conf;
+  ext_conf_t m_ext_cfg;
 
+  nlohmann::json m_init_args;
+  std::vector<appfwk::app::ConnectionReference> m_conn_refs;
   std::map<std::string, std::unique_ptr<readoutlibs::SourceEmulatorConcept>> m_source_emus;
 
   // Internals
-  std::unique_ptr<readoutlibs::FileSourceBuffer> m_source_buffer;
+  std::map<std::string, std::shared_ptr<const MappedSourceBuffer>> m_source_buffers;
+  std::unique_ptr<MultiplexedEmulatorEngine> m_engine;
+  ReplayClock m_replay_clock;
+  std::unique_ptr<SaturationRateFinder> m_rate_finder;
+
+  // Time to ready
+  startupinfo::Info m_startup_info;
 
   // Threading
   std::atomic<bool> m_run_marker;
+  // Held by the commands, so that get_info never sees the emulators being created or destroyed
+  std::mutex m_command_mutex;
 };
 
 } // namespace readoutmodules
@@ -0,0 +1,110 @@
+/**
+ * @file MultiLinkHandlerBase.hpp Handles several links behind one set of
+ * commands. Every link is a DataLinkHandlerBase of its own, with all of its
+ * features and opmon; the readouts that implement PolledReadoutConcept are
+ * driven by a few shared workers instead of threads of their own. This class
+ * is meant to be inherited to specify which readout specialization to load.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_MULTILINKHANDLERBASE_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_MULTILINKHANDLERBASE_HPP_
+
+#include "readoutmodules/DataLinkHandlerBase.hpp"
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/concepts/PolledReadoutConcept.hpp"
+#include "readoutmodules/multilinkhandlerconfig/Nljs.hpp"
+#include "readoutmodules/multilinkinfo/InfoNljs.hpp"
+#include "readoutmodules/utils/LinkWorkerPool.hpp"
+#include "readoutmodules/utils/ParallelFor.hpp"
+#include "readoutlibs/concepts/ReadoutConcept.hpp"
+#include "readoutlibs/ReadoutLogging.hpp"
+#include "appfwk/app/Nljs.hpp"
+#include "logging/Logging.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class MultiLinkHandlerBase
+{
+public:
+  /**
+   * @brief MultiLinkHandlerBase Constructor
+   * @param name Instance name for this MultiLinkHandlerBase instance
+   */
+  explicit MultiLinkHandlerBase(const std::string& name);
+  virtual ~MultiLinkHandlerBase();
+
+  MultiLinkHandlerBase(const MultiLinkHandlerBase&) = delete;            ///< MultiLinkHandlerBase is not copy-constructible
+  MultiLinkHandlerBase& operator=(const MultiLinkHandlerBase&) = delete; ///< MultiLinkHandlerBase is not copy-assignable
+  MultiLinkHandlerBase(MultiLinkHandlerBase&&) = delete;                 ///< MultiLinkHandlerBase is not move-constructible
+  MultiLinkHandlerBase& operator=(MultiLinkHandlerBase&&) = delete;      ///< MultiLinkHandlerBase is not move-assignable
+
+  void init(const nlohmann::json& args);
+  void get_info(opmonlib::InfoCollector& ci, int level);
+
+  /**
+   * @brief Create the readout of one link, as DataLinkHandlerBase::create_readout
+   * @param link Index of the link
+   * @param batch_size Elements per queue pop of this link (see make_batched)
+   */
+  virtual std::unique_ptr<dunedaq::readoutlibs::ReadoutConcept> create_readout(std::size_t link,
+                                                                             const nlohmann::json& args,
+                                                                             std::size_t batch_size,
+                                                                             std::atomic<bool>& run_marker) = 0;
+
+  // Commands
+  void do_conf(const nlohmann::json& /*args*/);
+  void do_scrap(const nlohmann::json& /*args*/);
+  void do_start(const nlohmann::json& /*args*/);
+  void do_stop(const nlohmann::json& /*args*/);
+  void do_record(const nlohmann::json& /*args*/);
+
+  std::string get_mlh_name() { return m_name; }
+
+private:
+  class Link;
+
+  // The init arguments of link index: its _link<index> connections under their plain names, and the shared ones
+  nlohmann::json get_link_init_args(std::size_t index) const;
+  // The polls of the pooled links for the workers
+  std::vector<LinkWorkerPool::poll_t> get_polls();
+
+  // Configuration
+  bool m_configured;
+  nlohmann::json m_init_args;
+  multilinkhandlerconfig::Conf m_cfg;
+
+  // Name
+  std::string m_name;
+
+  // Internal
+  std::vector<std::unique_ptr<Link>> m_links;
+  LinkWorkerPool m_pool;
+  LinkWorkerPoolStats m_last_pool_stats;
+
+  // Held by the commands, so that get_info never sees the links being created or destroyed
+  std::mutex m_command_mutex;
+  // Held by the links while they create their readout, and through its conf when it is not one of ours
+  std::mutex m_foreign_conf_mutex;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+// Declarations
+#include "detail/MultiLinkHandlerBase.hxx"
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_MULTILINKHANDLERBASE_HPP_
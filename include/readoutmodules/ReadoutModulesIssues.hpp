@@ -52,6 +52,16 @@ ERS_DECLARE_ISSUE(readoutmodules,
 
 ERS_DECLARE_ISSUE(readoutmodules, CannotOpenFile, "Couldn't open binary file: " << filename, ((std::string)filename))
 
+ERS_DECLARE_ISSUE(readoutmodules,
+                  CannotMapFile,
+                  "Couldn't memory-map binary file: " << filename << " Cause: " << errorstr,
+                  ((std::string)filename)((std::string)errorstr))
+
+ERS_DECLARE_ISSUE(readoutmodules,
+                  CannotReadRecording,
+                  "Couldn't read recorded file: " << filename << " Cause: " << errorstr,
+                  ((std::string)filename)((std::string)errorstr))
+
 ERS_DECLARE_ISSUE(readoutmodules,
                   BufferedReaderWriterCannotOpenFile,
                   "Couldn't open file: " << filename,
@@ -104,6 +114,11 @@ ERS_DECLARE_ISSUE_BASE(readoutmodules,
                        ((std::string)name),
                        ((std::string)initparams))
 
+ERS_DECLARE_ISSUE(readoutmodules,
+                  CommandOnUnconfiguredModule,
+                  name << " received " << command << " without a successful conf",
+                  ((std::string)name)((std::string)command))
+
 ERS_DECLARE_ISSUE(readoutmodules,
                   FailedFakeCardInitialization,
                   "Could not initialize fake card " << name,
@@ -0,0 +1,41 @@
+/**
+ * @file BatchedInputReadoutConcept.hpp Declares that a readout receives its
+ * raw input in FrameBatches and unpacks them into single elements as it
+ * writes its latency buffer, so that requests, timestamps and processing
+ * still see one element at a time. DataLinkHandlerBase only configures a
+ * batch size above 1 for readouts implementing it, as ReferenceReadoutModel
+ * does; the readoutlibs ReadoutModel would store the batches themselves.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_BATCHEDINPUTREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_BATCHEDINPUTREADOUTCONCEPT_HPP_
+
+#include <cstddef>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class BatchedInputReadoutConcept
+{
+public:
+  BatchedInputReadoutConcept() {}
+  virtual ~BatchedInputReadoutConcept() {}
+
+  BatchedInputReadoutConcept(const BatchedInputReadoutConcept&) = delete; ///< BatchedInputReadoutConcept is not copy-constructible
+  BatchedInputReadoutConcept& operator=(const BatchedInputReadoutConcept&) =
+    delete; ///< BatchedInputReadoutConcept is not copy-assginable
+  BatchedInputReadoutConcept(BatchedInputReadoutConcept&&) = delete; ///< BatchedInputReadoutConcept is not move-constructible
+  BatchedInputReadoutConcept& operator=(BatchedInputReadoutConcept&&) =
+    delete; ///< BatchedInputReadoutConcept is not move-assignable
+
+  //! Elements per raw input pop, 1 for unbatched input
+  virtual std::size_t get_input_batch_size() const = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_BATCHEDINPUTREADOUTCONCEPT_HPP_
@@ -0,0 +1,52 @@
+/**
+ * @file InstrumentedReadoutConcept.hpp Shows where the time of a readout
+ * goes. The implementation owns one LatencyHistogram per stage of its hot
+ * path and records into it as it runs; at every get_info the
+ * DataLinkHandlerBase takes the percentiles, which restarts the histograms,
+ * and publishes them as latencyinfo. Two TSC reads cost about as much as
+ * copying a small element, so the per-element stages may be sampled, their
+ * count then being the number of samples: ReferenceReadoutModel times one
+ * element in 16 and every request.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_INSTRUMENTEDREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_INSTRUMENTEDREADOUTCONCEPT_HPP_
+
+#include "readoutmodules/utils/LatencyHistogram.hpp"
+
+namespace dunedaq {
+namespace readoutmodules {
+
+//! The timed stages of the readout hot path
+struct ReadoutLatencyHistograms
+{
+  LatencyHistogram raw_pop_wait;   ///< Waiting for an element on the raw input queue
+  LatencyHistogram lb_write;       ///< Writing an element into the latency buffer
+  LatencyHistogram request_lookup; ///< Finding the data of a request in the latency buffer
+  LatencyHistogram fragment_send;  ///< Sending a fragment out
+};
+
+class InstrumentedReadoutConcept
+{
+public:
+  InstrumentedReadoutConcept() {}
+  virtual ~InstrumentedReadoutConcept() {}
+
+  InstrumentedReadoutConcept(const InstrumentedReadoutConcept&) = delete; ///< InstrumentedReadoutConcept is not copy-constructible
+  InstrumentedReadoutConcept& operator=(const InstrumentedReadoutConcept&) =
+    delete; ///< InstrumentedReadoutConcept is not copy-assginable
+  InstrumentedReadoutConcept(InstrumentedReadoutConcept&&) = delete; ///< InstrumentedReadoutConcept is not move-constructible
+  InstrumentedReadoutConcept& operator=(InstrumentedReadoutConcept&&) =
+    delete; ///< InstrumentedReadoutConcept is not move-assignable
+
+  //! Histograms filled by the implementation, with LatencyTimer or LatencyHistogram::record
+  virtual ReadoutLatencyHistograms& get_latency_histograms() = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_INSTRUMENTEDREADOUTCONCEPT_HPP_
@@ -0,0 +1,45 @@
+/**
+ * @file LossReportingReadoutConcept.hpp Interface of readout implementations
+ * that count the elements they lose. The DataLinkHandlerBase publishes the
+ * counters to the fake card of the same process (see LinkLossRegistry).
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_LOSSREPORTINGREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_LOSSREPORTINGREADOUTCONCEPT_HPP_
+
+#include <cstdint>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+//! Cumulative loss counters of a readout, since its conf
+struct ReadoutLossCounters
+{
+  uint64_t overwritten = 0; // NOLINT(build/unsigned) Latency buffer elements overwritten by newer data
+  uint64_t dropped = 0;     // NOLINT(build/unsigned) Raw input elements that did not make it into the latency buffer
+};
+
+class LossReportingReadoutConcept
+{
+public:
+  LossReportingReadoutConcept() {}
+  virtual ~LossReportingReadoutConcept() {}
+
+  LossReportingReadoutConcept(const LossReportingReadoutConcept&) = delete; ///< LossReportingReadoutConcept is not copy-constructible
+  LossReportingReadoutConcept& operator=(const LossReportingReadoutConcept&) =
+    delete; ///< LossReportingReadoutConcept is not copy-assginable
+  LossReportingReadoutConcept(LossReportingReadoutConcept&&) = delete; ///< LossReportingReadoutConcept is not move-constructible
+  LossReportingReadoutConcept& operator=(LossReportingReadoutConcept&&) =
+    delete; ///< LossReportingReadoutConcept is not move-assignable
+
+  //! Read from another thread while the readout runs, the counters must be atomics or equivalent
+  virtual ReadoutLossCounters get_loss_counters() const = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_LOSSREPORTINGREADOUTCONCEPT_HPP_
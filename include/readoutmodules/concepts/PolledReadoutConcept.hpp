@@ -0,0 +1,51 @@
+/**
+ * @file PolledReadoutConcept.hpp Interface of readout implementations that
+ * can leave their raw input consumer, data request handling and periodic
+ * tasks to the shared workers of a MultiLinkHandler, instead of running
+ * threads of their own.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_POLLEDREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_POLLEDREADOUTCONCEPT_HPP_
+
+#include <cstddef>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class PolledReadoutConcept
+{
+public:
+  PolledReadoutConcept() {}
+  virtual ~PolledReadoutConcept() {}
+
+  PolledReadoutConcept(const PolledReadoutConcept&) = delete; ///< PolledReadoutConcept is not copy-constructible
+  PolledReadoutConcept& operator=(const PolledReadoutConcept&) =
+    delete; ///< PolledReadoutConcept is not copy-assginable
+  PolledReadoutConcept(PolledReadoutConcept&&) = delete; ///< PolledReadoutConcept is not move-constructible
+  PolledReadoutConcept& operator=(PolledReadoutConcept&&) =
+    delete; ///< PolledReadoutConcept is not move-assignable
+
+  /**
+   * @brief Do not start consumer, request handling or periodic threads at start()
+   *
+   * Called before conf(). Between start() and stop() the methods below are
+   * then called by the shared workers, never by two threads at once.
+   */
+  virtual void set_externally_driven() = 0;
+
+  //! Move up to max_elements elements from the raw input into the latency buffer, without waiting; returns how many
+  virtual std::size_t poll_raw_input(std::size_t max_elements) = 0;
+  //! Serve up to max_requests pending data requests; returns how many
+  virtual std::size_t poll_requests(std::size_t max_requests) = 0;
+  //! Timesync, latency buffer cleanup and other periodic tasks; called about every periodic_interval_ms
+  virtual void run_periodic() = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_POLLEDREADOUTCONCEPT_HPP_
@@ -0,0 +1,48 @@
+/**
+ * @file PrefaultableReadoutConcept.hpp Hands the storage of the latency
+ * buffer to its DataLinkHandlerBase, which may bind it to a NUMA node, mark
+ * it for transparent hugepages and touch every page of it right after
+ * conf(). For this to pay off the readout must allocate the buffer without
+ * initializing it, as ReferenceReadoutModel does, and must not move it
+ * before scrap(); a buffer written at allocation is already faulted in.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_PREFAULTABLEREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_PREFAULTABLEREADOUTCONCEPT_HPP_
+
+#include <cstddef>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+//! A contiguous range of memory
+struct MemoryRegion
+{
+  void* data = nullptr;
+  std::size_t size = 0;
+};
+
+class PrefaultableReadoutConcept
+{
+public:
+  PrefaultableReadoutConcept() {}
+  virtual ~PrefaultableReadoutConcept() {}
+
+  PrefaultableReadoutConcept(const PrefaultableReadoutConcept&) = delete; ///< PrefaultableReadoutConcept is not copy-constructible
+  PrefaultableReadoutConcept& operator=(const PrefaultableReadoutConcept&) =
+    delete; ///< PrefaultableReadoutConcept is not copy-assginable
+  PrefaultableReadoutConcept(PrefaultableReadoutConcept&&) = delete; ///< PrefaultableReadoutConcept is not move-constructible
+  PrefaultableReadoutConcept& operator=(PrefaultableReadoutConcept&&) =
+    delete; ///< PrefaultableReadoutConcept is not move-assignable
+
+  //! The storage of the latency buffer, valid from the end of conf() to scrap()
+  virtual MemoryRegion get_latency_buffer_memory() = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_PREFAULTABLEREADOUTCONCEPT_HPP_
@@ -0,0 +1,49 @@
+/**
+ * @file RecordingReadoutConcept.hpp Lets the recording pipeline of the
+ * DataLinkHandler see the raw data. The recorder only copies bytes: the
+ * readout passes each element right after storing it, on the thread that
+ * stored it, and the recorder decides whether a recording window is open.
+ * Recording thus costs one relaxed load per element outside a window, and a
+ * copy into the current block inside one; ReferenceReadoutModel records from
+ * the latency buffer slot, so a recording is what requests were served from.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_RECORDINGREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_RECORDINGREADOUTCONCEPT_HPP_
+
+#include "readoutmodules/utils/RawRecorder.hpp"
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class RecordingReadoutConcept
+{
+public:
+  RecordingReadoutConcept() {}
+  virtual ~RecordingReadoutConcept() {}
+
+  RecordingReadoutConcept(const RecordingReadoutConcept&) = delete; ///< RecordingReadoutConcept is not copy-constructible
+  RecordingReadoutConcept& operator=(const RecordingReadoutConcept&) =
+    delete; ///< RecordingReadoutConcept is not copy-assginable
+  RecordingReadoutConcept(RecordingReadoutConcept&&) = delete; ///< RecordingReadoutConcept is not move-constructible
+  RecordingReadoutConcept& operator=(RecordingReadoutConcept&&) =
+    delete; ///< RecordingReadoutConcept is not move-assignable
+
+  /**
+   * @brief Pass every element written into the latency buffer to recorder
+   *
+   * Called before conf() with the recorder, and at scrap with nullptr. The
+   * consumer thread calls recorder->record(&element, sizeof(element)) after
+   * each latency buffer write; the call returns at once when no recording is
+   * active, and never blocks.
+   */
+  virtual void set_raw_recorder(RawRecorder* recorder) = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_RECORDINGREADOUTCONCEPT_HPP_
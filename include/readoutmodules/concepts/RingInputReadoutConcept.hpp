@@ -0,0 +1,50 @@
+/**
+ * @file RingInputReadoutConcept.hpp Interface of readout implementations
+ * that can take their raw input from an InProcessRing instead of their raw
+ * input queue, when the producer runs in the same process.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_RINGINPUTREADOUTCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_RINGINPUTREADOUTCONCEPT_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class RingInputReadoutConcept
+{
+public:
+  RingInputReadoutConcept() {}
+  virtual ~RingInputReadoutConcept() {}
+
+  RingInputReadoutConcept(const RingInputReadoutConcept&) = delete; ///< RingInputReadoutConcept is not copy-constructible
+  RingInputReadoutConcept& operator=(const RingInputReadoutConcept&) =
+    delete; ///< RingInputReadoutConcept is not copy-assginable
+  RingInputReadoutConcept(RingInputReadoutConcept&&) = delete; ///< RingInputReadoutConcept is not move-constructible
+  RingInputReadoutConcept& operator=(RingInputReadoutConcept&&) =
+    delete; ///< RingInputReadoutConcept is not move-assignable
+
+  /**
+   * @brief Read raw input from the ring of connection uid instead of the raw input queue
+   *
+   * Called before conf(). The implementation acquires the ring from the
+   * InProcessRingRegistry with its own element type, and its consumer pops
+   * elements with InProcessRing::pop_into (or read_slot, materialize and
+   * release) straight into the latency buffer.
+   *
+   * @param slots Slots of the ring, for its element type (see ring_slots)
+   */
+  virtual void attach_input_ring(const std::string& uid, std::size_t slots) = 0;
+  //! Release the ring; called at scrap
+  virtual void detach_input_ring() = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_RINGINPUTREADOUTCONCEPT_HPP_
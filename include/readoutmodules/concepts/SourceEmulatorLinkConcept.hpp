@@ -0,0 +1,72 @@
+/**
+ * @file SourceEmulatorLinkConcept.hpp SourceEmulatorConcept extension for
+ * emulated links whose source data is owned and shared by the
+ * FakeCardReaderBase instead of being loaded by every emulator.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_SOURCEEMULATORLINKCONCEPT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_SOURCEEMULATORLINKCONCEPT_HPP_
+
+#include "readoutmodules/utils/MappedSourceBuffer.hpp"
+#include "readoutmodules/utils/ReplayClock.hpp"
+
+#include "readoutlibs/concepts/SourceEmulatorConcept.hpp"
+#include "readoutlibs/sourceemulatorconfig/Structs.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+//! What the owner can see of the health of an emulated link while it runs
+struct EmulatedLinkHealth
+{
+  uint64_t sent = 0;          // NOLINT(build/unsigned) Elements handed over since conf
+  uint64_t send_failures = 0; // NOLINT(build/unsigned) Elements lost because the output stayed full
+  double fill = -1.;          // Fill of the output, from 0 to 1; negative when the output does not tell
+};
+
+class SourceEmulatorLinkConcept : public readoutlibs::SourceEmulatorConcept
+{
+public:
+  SourceEmulatorLinkConcept() {}
+  virtual ~SourceEmulatorLinkConcept() {}
+
+  SourceEmulatorLinkConcept(const SourceEmulatorLinkConcept&) = delete; ///< SourceEmulatorLinkConcept is not copy-constructible
+  SourceEmulatorLinkConcept& operator=(const SourceEmulatorLinkConcept&) =
+    delete;                                                         ///< SourceEmulatorLinkConcept is not copy-assginable
+  SourceEmulatorLinkConcept(SourceEmulatorLinkConcept&&) = delete; ///< SourceEmulatorLinkConcept is not move-constructible
+  SourceEmulatorLinkConcept& operator=(SourceEmulatorLinkConcept&&) =
+    delete; ///< SourceEmulatorLinkConcept is not move-assignable
+
+  //! The source file this link reads, picked from its link configuration
+  virtual std::string get_source_filename(
+    const readoutlibs::sourceemulatorconfig::LinkConfiguration& link_conf) const = 0;
+  //! Bind the shared source buffer; called by the owner before conf(). Links may hold on to it past scrap
+  virtual void set_source_buffer(std::shared_ptr<const MappedSourceBuffer> buffer) = 0;
+  //! Bind the time base shared by all links replaying recorded data; called by the owner before conf()
+  virtual void set_replay_clock(ReplayClock& clock) = 0;
+
+  //! Let an external engine drive the link instead of its own producer thread
+  virtual void set_engine_driven(bool engine_driven) = 0;
+  //! Emit the next element of an engine-driven link, returns the nominal period to the following one in ns.
+  //! Never waits: when the output is full the element is dropped and counted as a send failure
+  virtual double produce_next() = 0;
+
+  //! Element rate after slowdown, before any rate scale
+  virtual double get_nominal_rate_khz() const = 0;
+  //! Run at scale times the nominal rate; safe while running, taken into account from the next element
+  virtual void set_rate_scale(double scale) = 0;
+  //! Safe while running
+  virtual EmulatedLinkHealth get_link_health() const = 0;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_CONCEPTS_SOURCEEMULATORLINKCONCEPT_HPP_
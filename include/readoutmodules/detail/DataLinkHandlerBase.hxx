@@ -5,6 +5,11 @@ DataLinkHandlerBase::DataLinkHandlerBase(const std::string& name)
   : m_configured(false)
   , m_name(name)
   , m_readout_impl(nullptr)
+  , m_instrumented_impl(nullptr)
+  , m_ring_input_impl(nullptr)
+  , m_recording_impl(nullptr)
+  , m_loss_reporting_impl(nullptr)
+  , m_recorder(nullptr)
   , m_run_marker{ false }
 {
 /*
@@ -21,27 +26,259 @@ void
 DataLinkHandlerBase::init(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Entering init() method";
-  m_readout_impl = create_readout(args, m_run_marker);
-  if (m_readout_impl == nullptr) {
-    TLOG() << get_dlh_name() << "Initialize readout implementation FAILED! "
-           << "Failed to find specialization for given queue setup!";
-    throw dunedaq::readoutmodules::FailedReadoutInitialization(ERS_HERE, get_dlh_name(), args.dump()); // 4 json ident
-  }
+  // The readout is created at conf, once the batch size that selects its type is known
+  m_init_args = args;
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Exiting init() method";
 }
 
 void
 DataLinkHandlerBase::get_info(opmonlib::InfoCollector& ci, int level)
 {
+  // Skip this report rather than hold the monitoring thread for the whole of a command
+  std::unique_lock<std::mutex> lk(m_command_mutex, std::try_to_lock);
+  if (!lk.owns_lock() || m_readout_impl == nullptr) {
+    return;
+  }
   m_readout_impl->get_info(ci, level);
+
+  opmonlib::InfoCollector startup_ci;
+  startup_ci.add(m_startup_info);
+  ci.add("startup", startup_ci);
+
+  // The expansion and hit finding of the readout are not dispatched, they run at the level of the build flags
+  kernelinfo::Info kernel_info;
+  kernel_info.frame_expansion_simd_level = simd_level_name(built_simd_level());
+  kernel_info.hit_finding_simd_level = simd_level_name(built_simd_level());
+  kernel_info.cpu_simd_level = simd_level_name(detect_simd_level());
+  opmonlib::InfoCollector kernel_ci;
+  kernel_ci.add(kernel_info);
+  ci.add("kernels", kernel_ci);
+
+  if (m_instrumented_impl != nullptr) {
+    auto& histograms = m_instrumented_impl->get_latency_histograms();
+    add_latency_info(ci, "latency_raw_pop_wait", histograms.raw_pop_wait);
+    add_latency_info(ci, "latency_lb_write", histograms.lb_write);
+    add_latency_info(ci, "latency_request_lookup", histograms.request_lookup);
+    add_latency_info(ci, "latency_fragment_send", histograms.fragment_send);
+  }
+
+  if (m_recorder != nullptr) {
+    add_recording_info(ci);
+  }
+}
+
+void
+DataLinkHandlerBase::add_latency_info(opmonlib::InfoCollector& ci,
+                                      const std::string& stage,
+                                      LatencyHistogram& histogram)
+{
+  auto summary = histogram.take();
+
+  latencyinfo::Info info;
+  info.count = summary.count;
+  info.p50_ns = summary.p50_ns;
+  info.p90_ns = summary.p90_ns;
+  info.p99_ns = summary.p99_ns;
+  info.p999_ns = summary.p999_ns;
+  info.max_ns = summary.max_ns;
+
+  opmonlib::InfoCollector stage_ci;
+  stage_ci.add(info);
+  ci.add(stage, stage_ci);
+}
+
+void
+DataLinkHandlerBase::add_recording_info(opmonlib::InfoCollector& ci)
+{
+  const auto stats = m_recorder->get_stats();
+  const auto now = std::chrono::steady_clock::now();
+  const double seconds = std::chrono::duration<double>(now - m_last_recording_info).count();
+
+  recordinginfo::Info info;
+  info.recording = m_recorder->is_active();
+  info.recorded_bytes = stats.recorded_bytes - m_last_recording_stats.recorded_bytes;
+  info.written_bytes = stats.written_bytes - m_last_recording_stats.written_bytes;
+  info.recorded_gbytes_per_s = seconds > 0 ? info.recorded_bytes / seconds / 1e9 : 0;
+  info.written_gbytes_per_s = seconds > 0 ? info.written_bytes / seconds / 1e9 : 0;
+  info.dropped_elements = stats.dropped_records - m_last_recording_stats.dropped_records;
+  info.dropped_bytes = stats.dropped_bytes - m_last_recording_stats.dropped_bytes;
+  info.write_errors = stats.write_errors - m_last_recording_stats.write_errors;
+  m_last_recording_stats = stats;
+  m_last_recording_info = now;
+
+  opmonlib::InfoCollector recording_ci;
+  recording_ci.add(info);
+  ci.add("recording", recording_ci);
+}
+
+std::string
+DataLinkHandlerBase::get_raw_input_uid() const
+{
+  auto ini = m_init_args.get<appfwk::app::ModInit>();
+  for (const auto& ref : ini.conn_refs) {
+    if (ref.name == "raw_input") {
+      return ref.uid;
+    }
+  }
+  throw GenericConfigurationError(ERS_HERE, "No raw_input connection for " + m_name);
+}
+
+void
+DataLinkHandlerBase::check_batched_input()
+{
+  if (get_batch_size() == 1) {
+    return;
+  }
+  auto batched = dynamic_cast<BatchedInputReadoutConcept*>(m_readout_impl.get());
+  if (batched == nullptr) {
+    throw GenericConfigurationError(ERS_HERE,
+                                    "The readout of " + get_dlh_name() +
+                                      " cannot unpack batches into its latency buffer, its batch_size must be 1");
+  }
+  if (batched->get_input_batch_size() != get_batch_size()) {
+    throw GenericConfigurationError(ERS_HERE, "The readout of " + get_dlh_name() + " was created for another batch size");
+  }
+}
+
+void
+DataLinkHandlerBase::release_readout()
+{
+  if (m_loss_reporting_impl != nullptr) {
+    LinkLossRegistry::get().withdraw(get_raw_input_uid());
+    m_loss_reporting_impl = nullptr;
+  }
+  if (m_recording_impl != nullptr) {
+    m_recording_impl->set_raw_recorder(nullptr);
+    m_recording_impl = nullptr;
+  }
+  m_recorder.reset();
+  if (m_ring_input_impl != nullptr) {
+    m_ring_input_impl->detach_input_ring();
+    m_ring_input_impl = nullptr;
+  }
+  m_instrumented_impl = nullptr;
+  m_readout_impl.reset();
+  m_configured = false;
+}
+
+void
+DataLinkHandlerBase::prefault_latency_buffer()
+{
+  auto prefaultable = dynamic_cast<PrefaultableReadoutConcept*>(m_readout_impl.get());
+  if (prefaultable == nullptr) {
+    TLOG() << get_dlh_name() << ": the readout does not expose its latency buffer, it will be faulted in during the run";
+    return;
+  }
+  const auto region = prefaultable->get_latency_buffer_memory();
+  const std::size_t threads = m_ext_cfg.setup_threads > 0 ? m_ext_cfg.setup_threads : default_setup_threads();
+  const auto begin = std::chrono::steady_clock::now();
+  const auto result =
+    prefault_memory(region.data, region.size, m_ext_cfg.prefault_numa_node, m_ext_cfg.prefault_hugepages, threads);
+  m_startup_info.prefault_ms =
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  m_startup_info.prefaulted_bytes = result.bytes;
+  TLOG() << get_dlh_name() << ": prefaulted " << result.bytes << " bytes of latency buffer in "
+         << m_startup_info.prefault_ms << " ms" << (result.numa_bound ? " on the requested NUMA node" : "")
+         << (result.hugepages_advised ? " with transparent hugepages" : "");
+}
+
+void
+DataLinkHandlerBase::open_recorder()
+{
+  m_recording_impl = dynamic_cast<RecordingReadoutConcept*>(m_readout_impl.get());
+  if (m_recording_impl == nullptr) {
+    throw GenericConfigurationError(ERS_HERE, "The readout of " + get_dlh_name() + " cannot feed a recording pipeline");
+  }
+  if (m_ext_cfg.recording_output_file.empty()) {
+    throw GenericConfigurationError(ERS_HERE, "No recording_output_file for " + get_dlh_name());
+  }
+  RawRecorderConf conf;
+  conf.filename = m_ext_cfg.recording_output_file;
+  conf.block_size = m_ext_cfg.recording_block_size;
+  conf.blocks = m_ext_cfg.recording_blocks;
+  conf.engine = m_ext_cfg.recording_engine == datalinkhandlerconfig::RecordingEngine::io_uring ? RecorderEngine::io_uring
+                                                                                            : RecorderEngine::threads;
+  switch (m_ext_cfg.recording_compression) {
+    case datalinkhandlerconfig::Compression::lz4:
+      conf.compression = RecorderCompression::lz4;
+      break;
+    case datalinkhandlerconfig::Compression::zstd:
+      conf.compression = RecorderCompression::zstd;
+      break;
+    default:
+      conf.compression = RecorderCompression::none;
+  }
+  conf.threads = m_ext_cfg.recording_threads;
+  conf.direct_io = m_ext_cfg.recording_direct_io;
+
+  m_recorder = std::make_unique<RawRecorder>();
+  m_recorder->open(conf);
+  m_last_recording_stats = RawRecorderStats();
+  m_last_recording_info = std::chrono::steady_clock::now();
+  m_recording_impl->set_raw_recorder(m_recorder.get());
+  TLOG() << get_dlh_name() << " records raw data to " << conf.filename << " with "
+         << (m_recorder->get_engine() == RecorderEngine::io_uring ? "io_uring" : "writer threads")
+         << (m_recorder->is_direct_io() ? " and O_DIRECT" : "");
 }
 
 void
 DataLinkHandlerBase::do_conf(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Entering do_conf() method";
-  m_readout_impl->conf(args);
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  const auto conf_begin = std::chrono::steady_clock::now();
+  m_startup_info = startupinfo::Info();
+  m_ext_cfg = args.get<datalinkhandlerconfig::Conf>();
+  m_readout_impl = create_readout(m_init_args, m_run_marker);
+  if (m_readout_impl == nullptr) {
+    TLOG() << get_dlh_name() << "Initialize readout implementation FAILED! "
+           << "Failed to find specialization for given queue setup and batch size " << m_ext_cfg.batch_size << "!";
+    throw dunedaq::readoutmodules::FailedReadoutInitialization(ERS_HERE, get_dlh_name(), m_init_args.dump());
+  }
+  bool readout_configured = false;
+  try {
+    check_batched_input();
+    m_instrumented_impl = dynamic_cast<InstrumentedReadoutConcept*>(m_readout_impl.get());
+    if (m_instrumented_impl != nullptr) {
+      TscClock::ticks_per_ns(); // calibrate now rather than in the first get_info
+    } else if (m_ext_cfg.latency_histograms) {
+      throw GenericConfigurationError(ERS_HERE, "The readout of " + get_dlh_name() + " publishes no latency histograms");
+    }
+    if (m_ext_cfg.raw_input_transport == datalinkhandlerconfig::Transport::in_process_ring) {
+      auto ring_input = dynamic_cast<RingInputReadoutConcept*>(m_readout_impl.get());
+      if (ring_input == nullptr) {
+        throw GenericConfigurationError(ERS_HERE, "The readout of " + get_dlh_name() + " cannot read from an in-process ring");
+      }
+      ring_input->attach_input_ring(get_raw_input_uid(), ring_slots(m_ext_cfg.ring_capacity, get_batch_size()));
+      m_ring_input_impl = ring_input;
+      TLOG() << get_dlh_name() << " reads its raw input from the in-process ring " << get_raw_input_uid();
+    }
+    if (m_ext_cfg.recording_engine != datalinkhandlerconfig::RecordingEngine::readout) {
+      open_recorder();
+    }
+    m_readout_impl->conf(args);
+    readout_configured = true;
+    // A fake card in the same process watches the losses of its links, e.g. to find their saturation rate
+    auto loss_reporting = dynamic_cast<LossReportingReadoutConcept*>(m_readout_impl.get());
+    if (loss_reporting != nullptr) {
+      LinkLossRegistry::get().publish(get_raw_input_uid(), loss_reporting);
+      m_loss_reporting_impl = loss_reporting;
+    }
+    if (m_ext_cfg.prefault_latency_buffer) {
+      prefault_latency_buffer();
+    }
+  } catch (...) {
+    // Leave nothing half configured behind, a new conf starts over
+    if (readout_configured) {
+      m_readout_impl->scrap(args);
+    }
+    release_readout();
+    throw;
+  }
   m_configured = true;
+  m_startup_info.conf_ms =
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - conf_begin).count();
+  TLOG() << get_dlh_name() << " configured in " << m_startup_info.conf_ms << " ms";
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Exiting do_conf() method";
 }
 
@@ -49,16 +286,32 @@ void
 DataLinkHandlerBase::do_scrap(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Entering do_scrap() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  if (m_readout_impl == nullptr) {
+    TLOG() << get_dlh_name() << " is not configured, nothing to scrap";
+    return;
+  }
+  if (m_loss_reporting_impl != nullptr) {
+    LinkLossRegistry::get().withdraw(get_raw_input_uid());
+    m_loss_reporting_impl = nullptr;
+  }
   m_readout_impl->scrap(args);
-  m_configured = false;
+  release_readout();
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Exiting do_scrap() method";
 }
 void
 DataLinkHandlerBase::do_start(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Entering do_start() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  if (m_readout_impl == nullptr) {
+    throw CommandOnUnconfiguredModule(ERS_HERE, get_dlh_name(), "start");
+  }
+  const auto start_begin = std::chrono::steady_clock::now();
   m_run_marker.store(true);
   m_readout_impl->start(args);
+  m_startup_info.start_ms =
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_begin).count();
   rcif::cmd::StartParams start_params = args.get<rcif::cmd::StartParams>();
   m_run_number = start_params.run;
   TLOG() << get_dlh_name() << " successfully started for run number " << m_run_number;
@@ -69,8 +322,16 @@ void
 DataLinkHandlerBase::do_stop(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Entering do_stop() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
   m_run_marker.store(false);
+  if (m_readout_impl == nullptr) {
+    TLOG() << get_dlh_name() << " is not configured, nothing to stop";
+    return;
+  }
   m_readout_impl->stop(args);
+  if (m_recorder != nullptr) {
+    m_recorder->stop();
+  }
   TLOG() << get_dlh_name() << " successfully stopped for run number " << m_run_number;
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Exiting do_stop() method";
 }
@@ -79,7 +340,16 @@ void
 DataLinkHandlerBase::do_record(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Entering do_issue_recording() method";
-  m_readout_impl->record(args);
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  if (m_readout_impl == nullptr) {
+    ers::warning(CommandOnUnconfiguredModule(ERS_HERE, get_dlh_name(), "record"));
+  } else if (m_recorder != nullptr) {
+    auto params = args.get<readoutlibs::readoutconfig::RecordingParams>();
+    m_recorder->start(std::chrono::seconds(params.duration));
+    TLOG() << get_dlh_name() << " recording raw data for " << params.duration << " s";
+  } else {
+    m_readout_impl->record(args);
+  }
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_dlh_name() << ": Exiting do_issue_recording() method";
 }
 
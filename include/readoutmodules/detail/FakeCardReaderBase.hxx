@@ -18,82 +18,267 @@ void
 FakeCardReaderBase::init(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Entering init() method";
+  // The emulators are created at conf, once the batch size that selects their type is known
+  m_init_args = args;
   auto ini = args.get<appfwk::app::ModInit>();
   for (const auto& qi : ini.conn_refs) {
-    
-    try {
-      if (m_source_emus.find(qi.name) != m_source_emus.end()) {
+    for (const auto& other : m_conn_refs) {
+      if (other.name == qi.name) {
         TLOG() << get_fcr_name() << "Same queue instance used twice";
         throw readoutlibs::FailedFakeCardInitialization(ERS_HERE, get_fcr_name(), args.dump());
       }
+    }
+    m_conn_refs.push_back(qi);
+  }
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting init() method";
+}
+
+void
+FakeCardReaderBase::create_source_emulators()
+{
+  for (const auto& qi : m_conn_refs) {
+    try {
       m_source_emus[qi.name] = create_source_emulator(qi, m_run_marker);
       if (m_source_emus[qi.name].get() == nullptr) {
         TLOG() << get_fcr_name() << "Source emulator could not be created";
-        throw readoutlibs::FailedFakeCardInitialization(ERS_HERE, get_fcr_name(), args.dump());
+        throw readoutlibs::FailedFakeCardInitialization(ERS_HERE, get_fcr_name(), m_init_args.dump());
       }
-      m_source_emus[qi.name]->init(args);
+      m_source_emus[qi.name]->init(m_init_args);
       m_source_emus[qi.name]->set_sender(qi.uid);
     } catch (const ers::Issue& excpt) {
       throw readoutlibs::ResourceQueueError(ERS_HERE, qi.name, get_fcr_name(), excpt);
     }
   }
-  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting init() method";
 }
 
 void
 FakeCardReaderBase::get_info(opmonlib::InfoCollector& ci, int level)
 {
+  // Skip this report rather than hold the monitoring thread for the whole of a command
+  std::unique_lock<std::mutex> lk(m_command_mutex, std::try_to_lock);
+  if (!lk.owns_lock()) {
+    return;
+  }
 
   for (auto& [name, emu] : m_source_emus) {
     emu->get_info(ci, level);
   }
+
+  opmonlib::InfoCollector startup_ci;
+  startup_ci.add(m_startup_info);
+  ci.add("startup", startup_ci);
+
+  if (m_rate_finder != nullptr) {
+    add_rate_search_info(ci);
+  }
+}
+
+void
+FakeCardReaderBase::add_rate_search_info(opmonlib::InfoCollector& ci)
+{
+  const auto result = m_rate_finder->get_result();
+
+  opmonlib::InfoCollector search_ci;
+  bool handler_losses_observed = !result.links.empty();
+  for (const auto& link : result.links) {
+    ratesearchinfo::Info link_info;
+    link_info.state = link.converged ? "converged" : "searching";
+    link_info.rate_khz = link.rate_khz;
+    link_info.nominal_rate_khz = link.nominal_rate_khz;
+    link_info.rate_scale = link.scale;
+    link_info.current_scale = link.current_scale;
+    link_info.steps = link.steps;
+    link_info.lossy_steps = link.lossy_steps;
+    link_info.handler_losses_observed = link.handler_losses_observed;
+    handler_losses_observed = handler_losses_observed && link.handler_losses_observed;
+    opmonlib::InfoCollector link_ci;
+    link_ci.add(link_info);
+    search_ci.add(link.name, link_ci);
+  }
+
+  ratesearchinfo::Info info;
+  info.state = saturation_search_state_name(result.state);
+  info.rate_khz = result.rate_khz;
+  info.nominal_rate_khz = result.nominal_rate_khz;
+  info.rate_scale = result.nominal_rate_khz > 0. ? result.rate_khz / result.nominal_rate_khz : 0.;
+  info.steps = result.steps;
+  info.handler_losses_observed = handler_losses_observed;
+  search_ci.add(info);
+  ci.add("rate_search", search_ci);
+}
+
+void
+FakeCardReaderBase::create_rate_finder()
+{
+  if (m_ext_cfg.source_mode == fakecardreaderconfig::SourceMode::replay) {
+    throw readoutlibs::GenericConfigurationError(ERS_HERE, "Replay is paced by the recording, its rate cannot be searched");
+  }
+  std::vector<SaturationRateFinder::Probe> probes;
+  for (const auto& qi : m_conn_refs) {
+    auto link_emu = dynamic_cast<SourceEmulatorLinkConcept*>(m_source_emus[qi.name].get());
+    if (link_emu == nullptr) {
+      throw readoutlibs::GenericConfigurationError(ERS_HERE, "The rate of emulator " + qi.name + " cannot be searched");
+    }
+    probes.push_back({ qi.name, qi.uid, link_emu });
+  }
+
+  SaturationSearchConf conf;
+  conf.start_scale = m_ext_cfg.rate_search_start_scale;
+  conf.min_scale = m_ext_cfg.rate_search_min_scale;
+  conf.max_scale = m_ext_cfg.rate_search_max_scale;
+  conf.precision = m_ext_cfg.rate_search_precision;
+  conf.max_fill = m_ext_cfg.rate_search_max_fill;
+  conf.min_achieved = m_ext_cfg.rate_search_min_achieved;
+  conf.settle = std::chrono::milliseconds(m_ext_cfg.rate_search_settle_ms);
+  conf.window = std::chrono::milliseconds(m_ext_cfg.rate_search_window_ms);
+  conf.confirm_attempts = m_ext_cfg.rate_search_confirm_attempts;
+  if (conf.min_scale <= 0. || conf.min_scale > conf.max_scale || conf.precision <= 0. || conf.precision >= 1.) {
+    throw readoutlibs::GenericConfigurationError(ERS_HERE, "Inconsistent rate search settings for " + get_fcr_name());
+  }
+  m_rate_finder = std::make_unique<SaturationRateFinder>(std::move(probes), conf);
 }
 
 void
 FakeCardReaderBase::do_conf(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Entering do_conf() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
 
   if (m_configured) {
     TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS) << "This module is already configured!";
   } else {
+    const auto conf_begin = std::chrono::steady_clock::now();
     m_cfg = args.get<readoutlibs::sourceemulatorconfig::Conf>();
+    m_ext_cfg = args.get<fakecardreaderconfig::Conf>();
+    const bool replay = (m_ext_cfg.source_mode == fakecardreaderconfig::SourceMode::replay);
+    if (replay && m_ext_cfg.emulator_engine == fakecardreaderconfig::EmulatorEngine::multiplexed) {
+      throw readoutlibs::GenericConfigurationError(ERS_HERE, "Replay is paced per link, it cannot be multiplexed");
+    }
+    m_replay_clock.conf(m_ext_cfg.replay_speed, m_ext_cfg.clock_speed_hz);
+    try {
+      conf_source_emulators(args);
+    } catch (...) {
+      // Leave nothing half configured behind, a new conf starts over
+      release_source_emulators();
+      throw;
+    }
 
-    for (const auto& emu_conf : m_cfg.link_confs) {
-      if (m_source_emus.find(emu_conf.queue_name) == m_source_emus.end()) {
-        TLOG() << "Cannot find queue: " << emu_conf.queue_name << std::endl;
-        throw readoutlibs::GenericConfigurationError(ERS_HERE, "Cannot find queue: " + emu_conf.queue_name);
-      }
-      if (m_source_emus[emu_conf.queue_name]->is_configured()) {
-        TLOG() << "Emulator for queue name " << emu_conf.queue_name << " was already configured";
-        throw readoutlibs::GenericConfigurationError(ERS_HERE, "Emulator configured twice: " + emu_conf.queue_name);
-      }
+    // Mark configured
+    m_configured = true;
+    m_startup_info = startupinfo::Info();
+    m_startup_info.conf_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - conf_begin).count();
+    TLOG() << get_fcr_name() << " configured " << m_cfg.link_confs.size() << " links in " << m_startup_info.conf_ms
+           << " ms";
+  }
+
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting do_conf() method";
+}
+
+void
+FakeCardReaderBase::conf_source_emulators(const nlohmann::json& args)
+{
+  const bool replay = (m_ext_cfg.source_mode == fakecardreaderconfig::SourceMode::replay);
+  create_source_emulators();
+  const std::size_t setup_threads =
+    m_ext_cfg.setup_threads > 0 ? static_cast<std::size_t>(m_ext_cfg.setup_threads) : default_setup_threads();
+
+  // Shared resources are bound one link after the other, the links are then configured in parallel
+  std::set<std::string> configured;
+  std::set<std::string> filenames;
+  for (const auto& emu_conf : m_cfg.link_confs) {
+    if (m_source_emus.find(emu_conf.queue_name) == m_source_emus.end()) {
+      TLOG() << "Cannot find queue: " << emu_conf.queue_name << std::endl;
+      throw readoutlibs::GenericConfigurationError(ERS_HERE, "Cannot find queue: " + emu_conf.queue_name);
+    }
+    if (!configured.insert(emu_conf.queue_name).second) {
+      TLOG() << "Emulator for queue name " << emu_conf.queue_name << " was already configured";
+      throw readoutlibs::GenericConfigurationError(ERS_HERE, "Emulator configured twice: " + emu_conf.queue_name);
+    }
+    auto link_emu = dynamic_cast<SourceEmulatorLinkConcept*>(m_source_emus[emu_conf.queue_name].get());
+    if (link_emu == nullptr && m_ext_cfg.transport == fakecardreaderconfig::Transport::in_process_ring) {
+      ers::warning(ConfigurationNote(ERS_HERE,
+                                     get_fcr_name(),
+                                     "Emulator " + emu_conf.queue_name + " cannot write to an in-process ring, it keeps its queue"));
+    }
+    if (link_emu != nullptr && m_ext_cfg.source_mode == fakecardreaderconfig::SourceMode::file) {
+      filenames.insert(link_emu->get_source_filename(emu_conf));
+    } else if (m_ext_cfg.source_mode == fakecardreaderconfig::SourceMode::file) {
+      TLOG() << get_fcr_name() << ": emulator " << emu_conf.queue_name
+             << " does not share the source buffers, it loads its own copy of its source file";
+    }
+  }
+  map_source_buffers(filenames, setup_threads);
+
+  // Only the link emulators of this package are known to configure safely side by side, others take turns
+  std::vector<const readoutlibs::sourceemulatorconfig::LinkConfiguration*> link_confs;
+  for (const auto& emu_conf : m_cfg.link_confs) {
+    auto link_emu = dynamic_cast<SourceEmulatorLinkConcept*>(m_source_emus[emu_conf.queue_name].get());
+    if (link_emu == nullptr) {
       m_source_emus[emu_conf.queue_name]->conf(args, emu_conf);
+      continue;
+    }
+    if (replay) {
+      link_emu->set_replay_clock(m_replay_clock);
+    } else if (m_ext_cfg.source_mode == fakecardreaderconfig::SourceMode::file) {
+      link_emu->set_source_buffer(get_source_buffer(link_emu->get_source_filename(emu_conf)));
+    }
+    link_confs.push_back(&emu_conf);
+  }
+  parallel_for(link_confs.size(), setup_threads, [&](std::size_t i) {
+    m_source_emus[link_confs[i]->queue_name]->conf(args, *link_confs[i]);
+  });
+
+  for (auto& [name, emu] : m_source_emus) {
+    if (!emu->is_configured()) {
+      throw readoutlibs::GenericConfigurationError(ERS_HERE, "Not all links were configured");
     }
+  }
 
+  if (m_ext_cfg.emulator_engine == fakecardreaderconfig::EmulatorEngine::multiplexed) {
+    if (m_source_emus.empty()) {
+      throw readoutlibs::GenericConfigurationError(ERS_HERE, "No links to multiplex");
+    }
+    std::vector<SourceEmulatorLinkConcept*> links;
     for (auto& [name, emu] : m_source_emus) {
-      if (!emu->is_configured()) {
-        throw readoutlibs::GenericConfigurationError(ERS_HERE, "Not all links were configured");
+      auto link_emu = dynamic_cast<SourceEmulatorLinkConcept*>(emu.get());
+      if (link_emu == nullptr) {
+        throw readoutlibs::GenericConfigurationError(ERS_HERE, "Emulator cannot be multiplexed: " + name);
       }
+      links.push_back(link_emu);
     }
-
-    // Mark configured
-    m_configured = true;
+    m_engine = std::make_unique<MultiplexedEmulatorEngine>(m_run_marker);
+    m_engine->conf(links, m_ext_cfg.engine_threads, m_ext_cfg.engine_cpus);
+  }
+  if (m_ext_cfg.rate_search) {
+    create_rate_finder();
   }
+}
 
-  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting do_conf() method";
+void
+FakeCardReaderBase::release_source_emulators()
+{
+  m_rate_finder.reset();
+  m_engine.reset();
+  m_source_emus.clear();
+  m_source_buffers.clear();
+  m_configured = false;
 }
 
 void
 FakeCardReaderBase::do_scrap(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Entering do_scrap() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
 
+  m_rate_finder.reset();
+  if (m_engine != nullptr) {
+    m_engine->scrap();
+  }
   for (auto& [name, emu] : m_source_emus) {
     emu->scrap(args);
   }
-
-  m_configured = false;
+  release_source_emulators();
 
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting do_scrap() method";
 }
@@ -101,12 +286,25 @@ void
 FakeCardReaderBase::do_start(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Entering do_start() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  const auto start_begin = std::chrono::steady_clock::now();
 
   m_run_marker.store(true);
 
+  // Replaying links share their start instant, leaving them time to get ready
+  m_replay_clock.start(std::chrono::milliseconds(m_ext_cfg.replay_start_delay_ms));
   for (auto& [name, emu] : m_source_emus) {
     emu->start(args);
   }
+  if (m_engine != nullptr) {
+    m_engine->start();
+  }
+  if (m_rate_finder != nullptr) {
+    m_rate_finder->start();
+    TLOG() << get_fcr_name() << " searches the highest rate its links sustain without loss";
+  }
+  m_startup_info.start_ms =
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_begin).count();
 
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting do_start() method";
 }
@@ -115,9 +313,16 @@ void
 FakeCardReaderBase::do_stop(const nlohmann::json& args)
 {
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Entering do_stop() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
 
+  if (m_rate_finder != nullptr) {
+    m_rate_finder->stop();
+  }
   m_run_marker = false;
 
+  if (m_engine != nullptr) {
+    m_engine->stop();
+  }
   for (auto& [name, emu] : m_source_emus) {
     emu->stop(args);
   }
@@ -125,6 +330,38 @@ FakeCardReaderBase::do_stop(const nlohmann::json& args)
   TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_fcr_name() << ": Exiting do_stop() method";
 }
 
+void
+FakeCardReaderBase::map_source_buffers(const std::set<std::string>& filenames, std::size_t threads)
+{
+  std::vector<std::string> missing;
+  for (const auto& filename : filenames) {
+    if (m_source_buffers.find(filename) == m_source_buffers.end()) {
+      missing.push_back(filename);
+    }
+  }
+  // Hugepage-backed buffers are copies of the files, which dominates conf with many links
+  std::vector<std::shared_ptr<const MappedSourceBuffer>> mapped(missing.size());
+  parallel_for(missing.size(), threads, [&](std::size_t i) {
+    mapped[i] = std::make_shared<MappedSourceBuffer>(missing[i], m_cfg.input_limit, m_ext_cfg.source_buffer_hugepages);
+  });
+  for (std::size_t i = 0; i < missing.size(); ++i) {
+    m_source_buffers.emplace(missing[i], std::move(mapped[i]));
+  }
+}
+
+std::shared_ptr<const MappedSourceBuffer>
+FakeCardReaderBase::get_source_buffer(const std::string& filename)
+{
+  auto buffer = m_source_buffers.find(filename);
+  if (buffer == m_source_buffers.end()) {
+    buffer = m_source_buffers
+               .emplace(filename,
+                        std::make_shared<MappedSourceBuffer>(filename, m_cfg.input_limit, m_ext_cfg.source_buffer_hugepages))
+               .first;
+  }
+  return buffer->second;
+}
+
 } // namespace readoutmodules
 } // namespace dunedaq
 
@@ -0,0 +1,253 @@
+namespace dunedaq {
+namespace readoutmodules {
+
+// One link: a DataLinkHandlerBase creating its readout through the owner
+class MultiLinkHandlerBase::Link : public DataLinkHandlerBase
+{
+public:
+  Link(const std::string& name, MultiLinkHandlerBase& owner, std::size_t index)
+    : DataLinkHandlerBase(name)
+    , m_owner(owner)
+    , m_index(index)
+    , m_polled_impl(nullptr)
+  {}
+
+  std::unique_ptr<readoutlibs::ReadoutConcept> create_readout(const nlohmann::json& args,
+                                                              std::atomic<bool>& run_marker) override
+  {
+    // Readouts that cannot be polled are not ours, nor known to configure safely side by side: they take turns,
+    // holding the lock until conf_link() is done with them
+    std::unique_lock<std::mutex> lk(m_owner.m_foreign_conf_mutex);
+    auto readout = m_owner.create_readout(m_index, args, get_batch_size(), run_marker);
+    if (dynamic_cast<PolledReadoutConcept*>(readout.get()) == nullptr) {
+      m_foreign_conf_lock = std::move(lk);
+    }
+    m_polled_impl = m_owner.m_cfg.workers > 0 ? dynamic_cast<PolledReadoutConcept*>(readout.get()) : nullptr;
+    if (m_polled_impl != nullptr) {
+      m_polled_impl->set_externally_driven();
+    } else if (m_owner.m_cfg.workers > 0) {
+      TLOG() << get_dlh_name() << ": the readout cannot be polled, it runs its own threads";
+    }
+    return readout;
+  }
+
+  void conf_link(const nlohmann::json& args)
+  {
+    try {
+      do_conf(args);
+    } catch (...) {
+      m_foreign_conf_lock = std::unique_lock<std::mutex>();
+      throw;
+    }
+    m_foreign_conf_lock = std::unique_lock<std::mutex>();
+  }
+
+  PolledReadoutConcept* get_polled_impl() { return m_polled_impl; }
+
+private:
+  MultiLinkHandlerBase& m_owner;
+  std::size_t m_index;
+  PolledReadoutConcept* m_polled_impl;
+  std::unique_lock<std::mutex> m_foreign_conf_lock;
+};
+
+MultiLinkHandlerBase::MultiLinkHandlerBase(const std::string& name)
+  : m_configured(false)
+  , m_name(name)
+{}
+
+MultiLinkHandlerBase::~MultiLinkHandlerBase()
+{
+  m_pool.stop();
+}
+
+void
+MultiLinkHandlerBase::init(const nlohmann::json& args)
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Entering init() method";
+  // The links are created at conf, once their number is known
+  m_init_args = args;
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Exiting init() method";
+}
+
+nlohmann::json
+MultiLinkHandlerBase::get_link_init_args(std::size_t index) const
+{
+  auto ini = m_init_args.get<appfwk::app::ModInit>();
+  const std::string suffix = "_link" + std::to_string(index);
+  std::vector<appfwk::app::ConnectionReference> refs;
+  for (auto ref : ini.conn_refs) {
+    const auto pos = ref.name.rfind("_link");
+    if (pos == std::string::npos || ref.name.find_first_not_of("0123456789", pos + 5) != std::string::npos ||
+        pos + 5 == ref.name.size()) {
+      refs.push_back(ref); // Shared by all links
+    } else if (ref.name.compare(pos, std::string::npos, suffix) == 0) {
+      ref.name.erase(pos);
+      refs.push_back(ref);
+    }
+  }
+  ini.conn_refs = refs;
+  nlohmann::json args = ini;
+  return args;
+}
+
+void
+MultiLinkHandlerBase::get_info(opmonlib::InfoCollector& ci, int level)
+{
+  // Skip this report rather than hold the monitoring thread for the whole of a command
+  std::unique_lock<std::mutex> lk(m_command_mutex, std::try_to_lock);
+  if (!lk.owns_lock() || !m_configured) {
+    return;
+  }
+  std::size_t pooled = 0;
+  for (auto& link : m_links) {
+    opmonlib::InfoCollector link_ci;
+    link->get_info(link_ci, level);
+    ci.add(link->get_dlh_name(), link_ci);
+    pooled += (link->get_polled_impl() != nullptr) ? 1 : 0;
+  }
+
+  const auto stats = m_pool.get_stats();
+  multilinkinfo::Info info;
+  info.links = m_links.size();
+  info.pooled_links = pooled;
+  info.workers = m_pool.get_num_workers();
+  info.polls = stats.polls - m_last_pool_stats.polls;
+  info.busy_fraction =
+    info.polls > 0 ? static_cast<double>(stats.busy_polls - m_last_pool_stats.busy_polls) / info.polls : 0.;
+  info.work_items = stats.work_items - m_last_pool_stats.work_items;
+  info.steals = stats.steals - m_last_pool_stats.steals;
+  info.idle_sleeps = stats.idle_sleeps - m_last_pool_stats.idle_sleeps;
+  m_last_pool_stats = stats;
+  ci.add(info);
+}
+
+std::vector<LinkWorkerPool::poll_t>
+MultiLinkHandlerBase::get_polls()
+{
+  std::vector<LinkWorkerPool::poll_t> polls;
+  const std::size_t batch = static_cast<std::size_t>(std::max(1, m_cfg.poll_batch));
+  const auto interval = std::chrono::milliseconds(m_cfg.periodic_interval_ms);
+  for (auto& link : m_links) {
+    PolledReadoutConcept* polled = link->get_polled_impl();
+    if (polled == nullptr) {
+      continue;
+    }
+    // The pool never polls a link from two workers at once, so the poll can keep state
+    auto next_periodic = std::chrono::steady_clock::now();
+    polls.emplace_back([polled, batch, interval, next_periodic]() mutable {
+      std::size_t work = polled->poll_raw_input(batch);
+      work += polled->poll_requests(batch);
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= next_periodic) {
+        polled->run_periodic();
+        next_periodic = now + interval;
+      }
+      return work;
+    });
+  }
+  return polls;
+}
+
+void
+MultiLinkHandlerBase::do_conf(const nlohmann::json& args)
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Entering do_conf() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  const auto conf_begin = std::chrono::steady_clock::now();
+  m_cfg = args.get<multilinkhandlerconfig::Conf>();
+  if (m_cfg.links.empty()) {
+    throw GenericConfigurationError(ERS_HERE, "No links configured for " + get_mlh_name());
+  }
+  m_links.clear();
+  for (std::size_t i = 0; i < m_cfg.links.size(); ++i) {
+    const auto& name = m_cfg.links[i].name.empty() ? get_mlh_name() + "_link" + std::to_string(i) : m_cfg.links[i].name;
+    m_links.emplace_back(std::make_unique<Link>(name, *this, i));
+    m_links.back()->init(get_link_init_args(i));
+  }
+  // Links allocate and possibly prefault their latency buffers, configure them side by side
+  const std::size_t threads = m_cfg.setup_threads > 0 ? m_cfg.setup_threads : default_setup_threads();
+  try {
+    parallel_for(m_links.size(), threads, [&](std::size_t i) { m_links[i]->conf_link(m_cfg.links[i].conf); });
+  } catch (...) {
+    // Leave no link configured behind, a new conf starts over
+    for (auto& link : m_links) {
+      link->do_scrap(args);
+    }
+    m_links.clear();
+    throw;
+  }
+  auto polled = [](const std::unique_ptr<Link>& link) { return link->get_polled_impl() != nullptr; };
+  if (m_cfg.workers > 0 && std::none_of(m_links.begin(), m_links.end(), polled)) {
+    ers::warning(ConfigurationNote(
+      ERS_HERE, get_mlh_name(), "No readout implements PolledReadoutConcept, every link runs its own threads"));
+  }
+  m_configured = true;
+  TLOG() << get_mlh_name() << " configured " << m_links.size() << " links in "
+         << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - conf_begin).count() << " ms";
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Exiting do_conf() method";
+}
+
+void
+MultiLinkHandlerBase::do_scrap(const nlohmann::json& args)
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Entering do_scrap() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  m_pool.stop();
+  for (auto& link : m_links) {
+    link->do_scrap(args);
+  }
+  m_links.clear();
+  m_configured = false;
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Exiting do_scrap() method";
+}
+
+void
+MultiLinkHandlerBase::do_start(const nlohmann::json& args)
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Entering do_start() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  for (auto& link : m_links) {
+    link->do_start(args);
+  }
+  auto polls = get_polls();
+  if (!polls.empty()) {
+    const std::size_t pooled = polls.size();
+    m_pool.start(std::move(polls),
+                 m_cfg.workers,
+                 std::chrono::microseconds(m_cfg.idle_sleep_us),
+                 m_cfg.idle_spins,
+                 "mlh-worker");
+    m_last_pool_stats = LinkWorkerPoolStats();
+    TLOG() << get_mlh_name() << ": " << pooled << " of " << m_links.size() << " links polled by "
+           << m_pool.get_num_workers() << " workers";
+  }
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Exiting do_start() method";
+}
+
+void
+MultiLinkHandlerBase::do_stop(const nlohmann::json& args)
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Entering do_stop() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  // No poll may run while the readouts stop
+  m_pool.stop();
+  for (auto& link : m_links) {
+    link->do_stop(args);
+  }
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Exiting do_stop() method";
+}
+
+void
+MultiLinkHandlerBase::do_record(const nlohmann::json& args)
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Entering do_issue_recording() method";
+  std::lock_guard<std::mutex> lk(m_command_mutex);
+  for (auto& link : m_links) {
+    link->do_record(args);
+  }
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_ENTER_EXIT_METHODS) << get_mlh_name() << ": Exiting do_issue_recording() method";
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
@@ -0,0 +1,229 @@
+/**
+ * @file ReferenceReadoutModel.hpp A compact readout of this package, used
+ * by the benchmarks and as the reference implementation of the readout
+ * concepts declared here. Elements go into a ring latency buffer that keeps
+ * the newest ones, batches being unpacked into it; data requests are answered with the frames of their
+ * window and timesyncs report the newest timestamp. It runs three threads of
+ * its own, or none when a MultiLinkHandler polls it. The elements it stores
+ * can be recorded by the RawRecorder of its DataLinkHandler.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_MODELS_REFERENCEREADOUTMODEL_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_MODELS_REFERENCEREADOUTMODEL_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/concepts/BatchedInputReadoutConcept.hpp"
+#include "readoutmodules/concepts/InstrumentedReadoutConcept.hpp"
+#include "readoutmodules/concepts/LossReportingReadoutConcept.hpp"
+#include "readoutmodules/concepts/PolledReadoutConcept.hpp"
+#include "readoutmodules/concepts/PrefaultableReadoutConcept.hpp"
+#include "readoutmodules/concepts/RecordingReadoutConcept.hpp"
+#include "readoutmodules/concepts/RingInputReadoutConcept.hpp"
+#include "readoutmodules/referencereadoutinfo/InfoNljs.hpp"
+#include "readoutmodules/utils/FrameBatch.hpp"
+#include "readoutmodules/utils/InProcessRing.hpp"
+#include "readoutmodules/utils/TscClock.hpp"
+
+#include "readoutlibs/ReadoutLogging.hpp"
+#include "readoutlibs/concepts/ReadoutConcept.hpp"
+#include "readoutlibs/readoutconfig/Nljs.hpp"
+
+#include "appfwk/app/Nljs.hpp"
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/SourceID.hpp"
+#include "dfmessages/DataRequest.hpp"
+#include "dfmessages/TimeSync.hpp"
+#include "iomanager/IOManager.hpp"
+#include "logging/Logging.hpp"
+#include "rcif/cmd/Nljs.hpp"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+template<class ReadoutType>
+class ReferenceReadoutModel
+  : public readoutlibs::ReadoutConcept
+  , public PolledReadoutConcept
+  , public LossReportingReadoutConcept
+  , public RingInputReadoutConcept
+  , public InstrumentedReadoutConcept
+  , public PrefaultableReadoutConcept
+  , public RecordingReadoutConcept
+  , public BatchedInputReadoutConcept
+{
+public:
+  //! What the latency buffer keeps: the raw input type, or the element type of its batches
+  using element_t = typename batch_element_of<ReadoutType>::type;
+  static constexpr std::size_t s_batch_size = batch_size_of<ReadoutType>::value;
+
+  using raw_receiver_t = iomanager::ReceiverConcept<ReadoutType>;
+  using request_receiver_t = iomanager::ReceiverConcept<dfmessages::DataRequest>;
+  using timesync_sender_t = iomanager::SenderConcept<dfmessages::TimeSync>;
+  using fragment_sender_t = iomanager::SenderConcept<std::unique_ptr<daqdataformats::Fragment>>;
+
+  /**
+   * @brief ReferenceReadoutModel Constructor
+   * @param run_marker Run marker of the owning module, cleared before stop()
+   * @param instrumented Time the hot path into the latency histograms; off leaves them empty
+   */
+  explicit ReferenceReadoutModel(std::atomic<bool>& run_marker, bool instrumented = true)
+    : m_run_marker(run_marker)
+    , m_instrumented(instrumented)
+    , m_configured(false)
+    , m_externally_driven(false)
+    , m_capacity(0)
+    , m_run_number(0)
+    , m_pid(getpid())
+  {}
+  ~ReferenceReadoutModel() { join_threads(); }
+
+  void init(const nlohmann::json& args) override;
+  void conf(const nlohmann::json& args) override;
+  void scrap(const nlohmann::json& args) override;
+  void start(const nlohmann::json& args) override;
+  void stop(const nlohmann::json& args) override;
+  void record(const nlohmann::json& args) override;
+  void get_info(opmonlib::InfoCollector& ci, int level) override;
+
+  // Polled by the workers of a MultiLinkHandler
+  void set_externally_driven() override { m_externally_driven = true; }
+  std::size_t poll_raw_input(std::size_t max_elements) override;
+  std::size_t poll_requests(std::size_t max_requests) override;
+  void run_periodic() override;
+
+  // Raw input popped from the ring of a fake card in the same process, straight into the latency buffer
+  void attach_input_ring(const std::string& uid, std::size_t slots) override;
+  void detach_input_ring() override { m_input_ring.reset(); }
+
+  ReadoutLatencyHistograms& get_latency_histograms() override { return m_histograms; }
+  MemoryRegion get_latency_buffer_memory() override { return { m_buffer.get(), m_capacity * sizeof(element_t) }; }
+
+  // Every element stored goes on to the recorder of the DataLinkHandler, which ignores it outside a recording
+  void set_raw_recorder(RawRecorder* recorder) override { m_recorder = recorder; }
+
+  //! Elements missing between consecutive raw input timestamps, and elements reused while a request read them
+  ReadoutLossCounters get_loss_counters() const override;
+
+  std::size_t get_input_batch_size() const override { return s_batch_size; }
+
+protected:
+  // Thread bodies, when not externally driven
+  void run_consume();
+  void run_requests();
+  void run_timesync();
+
+  //! Serve a request, or keep it pending while its data is still to come
+  void dispatch_requests(dfmessages::DataRequest& request);
+
+private:
+  struct PendingRequest
+  {
+    dfmessages::DataRequest request;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  //! Append the elements of an input to the latency buffer, overwriting the oldest ones when full
+  void write_element(const ReadoutType& input);
+  //! Pop the oldest input of the ring into the latency buffer; false if the ring is empty
+  bool pop_ring_element();
+  //! Make the element just written at index visible to the requests
+  void publish_element(uint64_t index); // NOLINT(build/unsigned)
+  //! Send the fragment of request if its data is there or if it may not wait any more; false if it has to wait
+  bool try_serve(const dfmessages::DataRequest& request, bool last_attempt);
+  //! Retry the pending requests, oldest first; returns how many were served
+  std::size_t serve_pending(bool last_attempt);
+  void send_fragment(const dfmessages::DataRequest& request, std::unique_ptr<daqdataformats::Fragment> fragment);
+  void send_timesync();
+  void join_threads();
+
+  // Timing costs about as much as copying a small element, so only one element in s_timed_element_period is timed
+  bool time_element() const
+  {
+    return m_instrumented && m_written.load(std::memory_order_relaxed) % s_timed_element_period == 0;
+  }
+  //! Start of a stage, or 0 when it is not timed
+  static uint64_t stage_start(bool timed) { return timed ? TscClock::now() : 0; } // NOLINT(build/unsigned)
+  static void stage_end(bool timed, LatencyHistogram& histogram, uint64_t start) // NOLINT(build/unsigned)
+  {
+    if (timed) {
+      histogram.record(TscClock::now() - start);
+    }
+  }
+
+  // Constuctor params
+  std::atomic<bool>& m_run_marker;
+  const bool m_instrumented;
+
+  // Configuration
+  bool m_configured;
+  bool m_externally_driven;
+  daqdataformats::SourceID m_sourceid;
+  iomanager::timeout_t m_source_queue_timeout_ms;
+  std::chrono::milliseconds m_request_timeout_ms;
+  uint64_t m_frames_per_element; // NOLINT(build/unsigned)
+  std::size_t m_frame_size;
+
+  // Connections
+  std::string m_raw_input_uid;
+  std::shared_ptr<raw_receiver_t> m_raw_receiver;
+  std::shared_ptr<InProcessRing<ReadoutType>> m_input_ring;
+  std::shared_ptr<request_receiver_t> m_request_receiver;
+  std::shared_ptr<timesync_sender_t> m_timesync_sender;
+  RawRecorder* m_recorder = nullptr;
+
+  // Latency buffer: element i of the stream is in slot i % m_capacity, only the newest m_capacity are kept
+  std::unique_ptr<element_t[]> m_buffer;
+  std::size_t m_capacity;
+  std::atomic<uint64_t> m_written{ 0 }; // NOLINT(build/unsigned)
+  uint64_t m_newest_timestamp = 0;      // NOLINT(build/unsigned) Owned by the raw input consumer
+
+  // Requests waiting for their data, owned by the request handling
+  std::deque<PendingRequest> m_pending;
+
+  // Run
+  daqdataformats::run_number_t m_run_number;
+  uint64_t m_timesync_seqno = 0; // NOLINT(build/unsigned)
+  pid_t m_pid;
+
+  // Stats
+  std::atomic<uint64_t> m_requests{ 0 };       // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_fragments{ 0 };      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_data_not_found{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_timesyncs{ 0 };      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_dropped{ 0 };        // NOLINT(build/unsigned) Since conf
+  std::atomic<uint64_t> m_overwritten{ 0 };    // NOLINT(build/unsigned) Since conf
+  uint64_t m_last_written = 0;                 // NOLINT(build/unsigned)
+  std::chrono::steady_clock::time_point m_last_info_time;
+  ReadoutLatencyHistograms m_histograms;
+  static constexpr uint64_t s_timed_element_period = 16; // NOLINT(build/unsigned)
+
+  // Threading
+  std::thread m_consumer_thread;
+  std::thread m_request_thread;
+  std::thread m_timesync_thread;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+// Declarations
+#include "detail/ReferenceReadoutModel.hxx"
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_MODELS_REFERENCEREADOUTMODEL_HPP_
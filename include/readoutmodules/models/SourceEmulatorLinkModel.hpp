@@ -0,0 +1,188 @@
+/**
+ * @file SourceEmulatorLinkModel.hpp Emulates a single link of a readout card
+ * by replaying frames from a source buffer shared with every other link of
+ * the same FakeCardReaderBase, or by synthesizing them, while updating the
+ * timestamps of the data.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_MODELS_SOURCEEMULATORLINKMODEL_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_MODELS_SOURCEEMULATORLINKMODEL_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/concepts/SourceEmulatorLinkConcept.hpp"
+#include "readoutmodules/emulatorlinkinfo/InfoNljs.hpp"
+#include "readoutmodules/fakecardreaderconfig/Nljs.hpp"
+#include "readoutmodules/utils/AdcNoiseGenerator.hpp"
+#include "readoutmodules/utils/FrameBatch.hpp"
+#include "readoutmodules/utils/FrameGeneratorTraits.hpp"
+#include "readoutmodules/utils/InProcessRing.hpp"
+#include "readoutmodules/utils/MappedSourceBuffer.hpp"
+#include "readoutmodules/utils/ReplayClock.hpp"
+#include "readoutmodules/utils/SequentialFileReader.hpp"
+#include "readoutmodules/utils/TscClock.hpp"
+
+#include "readoutlibs/ReadoutLogging.hpp"
+#include "readoutlibs/sourceemulatorconfig/Nljs.hpp"
+#include "readoutlibs/utils/RateLimiter.hpp"
+#include "readoutlibs/utils/ReusableThread.hpp"
+
+#include "daqdataformats/SourceID.hpp"
+#include "iomanager/IOManager.hpp"
+#include "logging/Logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+template<class ReadoutType>
+class SourceEmulatorLinkModel : public SourceEmulatorLinkConcept
+{
+public:
+  using sink_t = iomanager::SenderConcept<ReadoutType>;
+  using module_conf_t = readoutlibs::sourceemulatorconfig::Conf;
+  using link_conf_t = readoutlibs::sourceemulatorconfig::LinkConfiguration;
+  using ext_conf_t = fakecardreaderconfig::Conf;
+
+  /**
+   * @brief SourceEmulatorLinkModel Constructor
+   * @param name Name of the emulated link, usually the output queue name
+   * @param run_marker Run marker shared with the owning module
+   * @param time_tick_diff Timestamp ticks between two consecutive frames
+   * @param rate_khz Nominal element rate of the link, before slowdown; a FrameBatch is sent once per batch
+   * @param is_tp_link Read from the TP data file instead of the raw data file
+   */
+  explicit SourceEmulatorLinkModel(const std::string& name,
+                                   std::atomic<bool>& run_marker,
+                                   uint64_t time_tick_diff, // NOLINT(build/unsigned)
+                                   double rate_khz,
+                                   bool is_tp_link = false)
+    : m_run_marker(run_marker)
+    , m_time_tick_diff(time_tick_diff)
+    , m_rate_khz(rate_khz)
+    , m_is_tp_link(is_tp_link)
+    , m_is_configured(false)
+    , m_engine_driven(false)
+    , m_name(name)
+    , m_source_buffer(nullptr)
+    , m_replay_clock(nullptr)
+    , m_period_ns(0.)
+    , m_offset(0)
+    , m_num_elem(0)
+    , m_num_frames(0)
+    , m_timestamp(0)
+    , m_producer_thread(0)
+  {}
+
+  void init(const nlohmann::json& /*args*/) override {}
+  void set_sender(const std::string& conn_name) override;
+
+  std::string get_source_filename(const link_conf_t& link_conf) const override
+  {
+    return m_is_tp_link ? link_conf.tp_data_filename : link_conf.data_filename;
+  }
+  void set_source_buffer(std::shared_ptr<const MappedSourceBuffer> buffer) override
+  {
+    m_source_buffer = std::move(buffer);
+  }
+  void set_replay_clock(ReplayClock& clock) override { m_replay_clock = &clock; }
+
+  void set_engine_driven(bool engine_driven) override { m_engine_driven = engine_driven; }
+  double produce_next() override;
+
+  double get_nominal_rate_khz() const override { return m_period_ns > 0. ? 1e6 / m_period_ns : 0.; }
+  void set_rate_scale(double scale) override { m_rate_scale.store(scale, std::memory_order_relaxed); }
+  EmulatedLinkHealth get_link_health() const override;
+
+  void conf(const nlohmann::json& args, const nlohmann::json& link_conf) override;
+  bool is_configured() override { return m_is_configured; }
+  void scrap(const nlohmann::json& /*args*/) override;
+  void start(const nlohmann::json& /*args*/) override;
+  void stop(const nlohmann::json& /*args*/) override;
+  // Only reads counters and values set at conf, the owner must not call it during conf or scrap
+  void get_info(opmonlib::InfoCollector& ci, int /*level*/) override;
+
+protected:
+  void prepare_produce();
+  // Synthesize the samples of an element, leaving its headers untouched
+  void generate(ReadoutType& element);
+  // The current element of the source buffer
+  const ReadoutType* source_element() const
+  {
+    return reinterpret_cast<const ReadoutType*>(m_source_buffer->data() + m_offset * sizeof(ReadoutType));
+  }
+  // Hand an element over to the queue or to the ring; engine-driven links drop it when the output is full
+  void send(ReadoutType& payload);
+  // Wait up to the queue timeout for a free ring slot, nullptr if none came; engine-driven links do not wait
+  typename InProcessRing<ReadoutType>::slot_t* wait_ring_slot();
+  // Count an element the full output did not take, without waiting
+  void drop_element();
+  void run_produce();
+  void run_replay();
+
+private:
+  // Constuctor params
+  std::atomic<bool>& m_run_marker;
+  uint64_t m_time_tick_diff; // NOLINT(build/unsigned)
+  double m_rate_khz;
+  bool m_is_tp_link;
+
+  // Configuration
+  bool m_is_configured;
+  bool m_engine_driven;
+  std::string m_name;
+  module_conf_t m_conf;
+  link_conf_t m_link_conf;
+  ext_conf_t m_ext_conf;
+  daqdataformats::SourceID m_sourceid;
+  iomanager::timeout_t m_sink_queue_timeout_ms;
+  std::shared_ptr<sink_t> m_raw_data_sender;
+  std::string m_conn_uid;
+  std::shared_ptr<InProcessRing<ReadoutType>> m_ring;
+
+  // Internals
+  std::shared_ptr<const MappedSourceBuffer> m_source_buffer;
+  ReplayClock* m_replay_clock;
+  std::unique_ptr<SequentialFileReader> m_reader;
+  std::unique_ptr<readoutlibs::RateLimiter> m_rate_limiter;
+  std::unique_ptr<AdcNoiseGenerator> m_generator;
+  std::string m_simd_level; // Noise kernel of m_generator, for get_info
+  double m_period_ns;
+  std::atomic<double> m_rate_scale{ 1. };
+
+  // Produce state, owned by the producer thread or by the driving engine
+  ReadoutType m_payload;
+  std::size_t m_offset;
+  std::size_t m_num_elem;
+  uint64_t m_num_frames; // NOLINT(build/unsigned)
+  uint64_t m_timestamp;  // NOLINT(build/unsigned)
+  std::vector<uint16_t> m_adcs; // NOLINT(build/unsigned)
+
+  // Stats
+  std::atomic<uint64_t> m_packet_count{ 0 };     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_packet_count_tot{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_send_failures{ 0 };    // NOLINT(build/unsigned)
+  bool m_output_blocked = false; // The last element was dropped, owned by the producing thread
+  std::chrono::steady_clock::time_point m_last_info_time;
+
+  // Threading
+  readoutlibs::ReusableThread m_producer_thread;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+// Declarations
+#include "detail/SourceEmulatorLinkModel.hxx"
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_MODELS_SOURCEEMULATORLINKMODEL_HPP_
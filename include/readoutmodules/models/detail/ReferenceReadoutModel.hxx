@@ -0,0 +1,440 @@
+// Declarations for ReferenceReadoutModel
+
+namespace dunedaq {
+namespace readoutmodules {
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::init(const nlohmann::json& args)
+{
+  auto ini = args.get<appfwk::app::ModInit>();
+  for (const auto& ref : ini.conn_refs) {
+    if (ref.name == "raw_input") {
+      m_raw_input_uid = ref.uid;
+      m_raw_receiver = get_iom_receiver<ReadoutType>(ref.uid);
+    } else if (ref.name == "request_input") {
+      m_request_receiver = get_iom_receiver<dfmessages::DataRequest>(ref.uid);
+    } else if (ref.name == "timesync_output") {
+      m_timesync_sender = get_iom_sender<dfmessages::TimeSync>(ref.uid);
+    }
+  }
+  if (m_raw_receiver == nullptr || m_request_receiver == nullptr) {
+    throw ResourceQueueError(ERS_HERE, "raw_input or request_input", "ReferenceReadoutModel");
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::attach_input_ring(const std::string& uid, std::size_t slots)
+{
+  m_input_ring = InProcessRingRegistry::get().acquire<ReadoutType>(uid, slots);
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::conf(const nlohmann::json& args)
+{
+  auto conf = args["readoutmodelconf"].get<readoutlibs::readoutconfig::ReadoutModelConf>();
+  auto lb_conf = args["latencybufferconf"].get<readoutlibs::readoutconfig::LatencyBufferConf>();
+  auto rh_conf = args["requesthandlerconf"].get<readoutlibs::readoutconfig::RequestHandlerConf>();
+  m_sourceid.id = conf.source_id;
+  m_sourceid.subsystem = element_t::subsystem;
+  m_source_queue_timeout_ms = iomanager::timeout_t(conf.source_queue_timeout_ms);
+  m_request_timeout_ms = std::chrono::milliseconds(rh_conf.request_timeout_ms);
+
+  if (lb_conf.latency_buffer_size == 0) {
+    throw ConfigurationError(ERS_HERE, m_sourceid, "The latency buffer needs at least one element");
+  }
+  // Left uninitialized: the pages are faulted in by the first writes, or by a prefault at conf. Whole
+  // batches, so that every batch lands in consecutive slots
+  m_capacity = (lb_conf.latency_buffer_size + s_batch_size - 1) / s_batch_size * s_batch_size;
+  m_buffer.reset(new element_t[m_capacity]);
+  element_t sizes{}; // The buffer holds no element yet
+  m_frames_per_element = sizes.get_num_frames();
+  m_frame_size = sizes.get_frame_size();
+  m_dropped = 0;
+  m_overwritten = 0;
+  m_configured = true;
+
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS)
+    << "Reference readout " << m_sourceid << " keeps the newest " << m_capacity << " elements"
+    << (m_externally_driven ? ", polled by shared workers" : "");
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::scrap(const nlohmann::json& /*args*/)
+{
+  m_input_ring.reset();
+  m_buffer.reset();
+  m_capacity = 0;
+  m_configured = false;
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::start(const nlohmann::json& args)
+{
+  m_run_number = args.get<rcif::cmd::StartParams>().run;
+  m_written = 0;
+  m_last_written = 0;
+  m_timesync_seqno = 0;
+  m_last_info_time = std::chrono::steady_clock::now();
+  if (!m_externally_driven) {
+    m_consumer_thread = std::thread(&ReferenceReadoutModel<ReadoutType>::run_consume, this);
+    m_request_thread = std::thread(&ReferenceReadoutModel<ReadoutType>::run_requests, this);
+    m_timesync_thread = std::thread(&ReferenceReadoutModel<ReadoutType>::run_timesync, this);
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::stop(const nlohmann::json& /*args*/)
+{
+  // The run marker is already cleared, and polling workers are stopped before the readouts
+  join_threads();
+  // Nobody is left to wait for the missing data
+  serve_pending(true);
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::record(const nlohmann::json& /*args*/)
+{
+  TLOG() << "The reference readout " << m_sourceid << " records through the pipeline of its DataLinkHandler only";
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  const auto now = std::chrono::steady_clock::now();
+  const double seconds = std::chrono::duration<double>(now - m_last_info_time).count();
+  m_last_info_time = now;
+
+  referencereadoutinfo::Info info;
+  const uint64_t written = m_written.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  info.sum_payloads = written;
+  info.num_payloads = written - m_last_written;
+  info.rate_payloads_consumed = seconds > 0. ? info.num_payloads / seconds / 1000. : 0.;
+  info.num_buffer_elements = std::min<uint64_t>(written, m_capacity); // NOLINT(build/unsigned)
+  info.num_requests = m_requests.exchange(0);
+  info.num_fragments = m_fragments.exchange(0);
+  info.num_data_not_found = m_data_not_found.exchange(0);
+  info.num_timesyncs = m_timesyncs.exchange(0);
+  m_last_written = written;
+  ci.add(info);
+}
+
+template<class ReadoutType>
+std::size_t
+ReferenceReadoutModel<ReadoutType>::poll_raw_input(std::size_t max_elements)
+{
+  std::size_t elements = 0;
+  if (m_input_ring != nullptr) {
+    while (elements < max_elements && pop_ring_element()) {
+      ++elements;
+    }
+    return elements;
+  }
+  while (elements < max_elements) {
+    const bool timed = time_element();
+    const uint64_t start = stage_start(timed); // NOLINT(build/unsigned)
+    auto element = m_raw_receiver->try_receive(iomanager::timeout_t(0));
+    if (!element) {
+      break;
+    }
+    stage_end(timed, m_histograms.raw_pop_wait, start);
+    write_element(*element);
+    ++elements;
+  }
+  return elements;
+}
+
+template<class ReadoutType>
+std::size_t
+ReferenceReadoutModel<ReadoutType>::poll_requests(std::size_t max_requests)
+{
+  std::size_t requests = serve_pending(false);
+  while (requests < max_requests) {
+    auto request = m_request_receiver->try_receive(iomanager::timeout_t(0));
+    if (!request) {
+      break;
+    }
+    dispatch_requests(*request);
+    ++requests;
+  }
+  return requests;
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::run_periodic()
+{
+  send_timesync();
+}
+
+template<class ReadoutType>
+ReadoutLossCounters
+ReferenceReadoutModel<ReadoutType>::get_loss_counters() const
+{
+  ReadoutLossCounters counters;
+  counters.dropped = m_dropped.load(std::memory_order_relaxed);
+  counters.overwritten = m_overwritten.load(std::memory_order_relaxed);
+  return counters;
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::run_consume()
+{
+  pthread_setname_np(pthread_self(), ("refconsume-" + std::to_string(m_sourceid.id)).substr(0, 15).c_str());
+  while (m_input_ring != nullptr && m_run_marker.load(std::memory_order_relaxed)) {
+    if (!pop_ring_element()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+  }
+  while (m_input_ring == nullptr && m_run_marker.load(std::memory_order_relaxed)) {
+    const bool timed = time_element();
+    const uint64_t start = stage_start(timed); // NOLINT(build/unsigned)
+    auto element = m_raw_receiver->try_receive(m_source_queue_timeout_ms);
+    if (element) {
+      stage_end(timed, m_histograms.raw_pop_wait, start);
+      write_element(*element);
+    }
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::run_requests()
+{
+  pthread_setname_np(pthread_self(), ("refrequests-" + std::to_string(m_sourceid.id)).substr(0, 15).c_str());
+  while (m_run_marker.load(std::memory_order_relaxed)) {
+    serve_pending(false);
+    auto request = m_request_receiver->try_receive(iomanager::timeout_t(10));
+    if (request) {
+      dispatch_requests(*request);
+    }
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::run_timesync()
+{
+  pthread_setname_np(pthread_self(), ("reftimesync-" + std::to_string(m_sourceid.id)).substr(0, 15).c_str());
+  // Same interval as the periodic tasks of a MultiLinkHandler
+  const auto interval = std::chrono::milliseconds(100);
+  auto next = std::chrono::steady_clock::now() + interval;
+  while (m_run_marker.load(std::memory_order_relaxed)) {
+    if (std::chrono::steady_clock::now() >= next) {
+      send_timesync();
+      next += interval;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::dispatch_requests(dfmessages::DataRequest& request)
+{
+  m_requests.fetch_add(1, std::memory_order_relaxed);
+  if (!try_serve(request, false)) {
+    m_pending.push_back({ request, std::chrono::steady_clock::now() + m_request_timeout_ms });
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::write_element(const ReadoutType& input)
+{
+  const bool timed = time_element();
+  const uint64_t start = stage_start(timed);                       // NOLINT(build/unsigned)
+  const uint64_t index = m_written.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  const element_t* elements = batch_element_of<ReadoutType>::elements(input);
+  for (std::size_t i = 0; i < s_batch_size; ++i) {
+    m_buffer[(index + i) % m_capacity] = elements[i];
+    publish_element(index + i);
+  }
+  stage_end(timed, m_histograms.lb_write, start);
+}
+
+template<class ReadoutType>
+bool
+ReferenceReadoutModel<ReadoutType>::pop_ring_element()
+{
+  const bool timed = time_element();
+  const uint64_t start = stage_start(timed);                       // NOLINT(build/unsigned)
+  const uint64_t index = m_written.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  // A batch fills the consecutive slots of its elements, the capacity being a whole number of batches
+  if (!m_input_ring->pop_into(*reinterpret_cast<ReadoutType*>(&m_buffer[index % m_capacity]))) {
+    return false;
+  }
+  for (std::size_t i = 0; i < s_batch_size; ++i) {
+    publish_element(index + i);
+  }
+  // The pop is the copy into the latency buffer, there is no wait to tell apart
+  stage_end(timed, m_histograms.lb_write, start);
+  return true;
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::publish_element(uint64_t index) // NOLINT(build/unsigned)
+{
+  // Elements follow each other without gap, a jump means the ones in between were lost on the way
+  const uint64_t timestamp = m_buffer[index % m_capacity].get_first_timestamp();               // NOLINT(build/unsigned)
+  const uint64_t element_ticks = m_frames_per_element * element_t::expected_tick_difference; // NOLINT(build/unsigned)
+  if (index > 0 && timestamp > m_newest_timestamp + element_ticks) {
+    m_dropped.fetch_add((timestamp - m_newest_timestamp) / element_ticks - 1, std::memory_order_relaxed);
+  }
+  m_newest_timestamp = timestamp;
+  if (m_recorder != nullptr) {
+    m_recorder->record(&m_buffer[index % m_capacity], sizeof(element_t));
+  }
+  // Only this thread writes; readers check after copying that the slots they read were not reused meanwhile
+  m_written.store(index + 1, std::memory_order_release);
+}
+
+template<class ReadoutType>
+bool
+ReferenceReadoutModel<ReadoutType>::try_serve(const dfmessages::DataRequest& request, bool last_attempt)
+{
+  const uint64_t tick_diff = element_t::expected_tick_difference;    // NOLINT(build/unsigned)
+  const uint64_t element_ticks = m_frames_per_element * tick_diff;   // NOLINT(build/unsigned)
+  const uint64_t begin = request.request_information.window_begin;   // NOLINT(build/unsigned)
+  const uint64_t end = request.request_information.window_end;       // NOLINT(build/unsigned)
+  auto timestamp = [&](uint64_t index) { return m_buffer[index % m_capacity].get_first_timestamp(); }; // NOLINT
+
+  const uint64_t start = stage_start(m_instrumented);                // NOLINT(build/unsigned)
+  const uint64_t newest = m_written.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+  const bool arrived = newest > 0 && end <= timestamp(newest - 1) + element_ticks;
+  if (!arrived && !last_attempt) {
+    return false; // The end of the window is still to come
+  }
+
+  // First element with a frame at or after the window begin, among the ones still kept
+  std::vector<std::pair<void*, size_t>> pieces;
+  uint64_t first = newest > m_capacity ? newest - m_capacity : 0; // NOLINT(build/unsigned)
+  if (newest > 0) {
+    uint64_t count = newest - first; // NOLINT(build/unsigned)
+    while (count > 0) {
+      const uint64_t half = count / 2; // NOLINT(build/unsigned)
+      if (timestamp(first + half) + element_ticks <= begin) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    // Whole frames of [begin, end), elements being back to back frames
+    for (uint64_t index = first; index < newest; ++index) { // NOLINT(build/unsigned)
+      const uint64_t ts = timestamp(index);                 // NOLINT(build/unsigned)
+      if (ts >= end) {
+        break;
+      }
+      const uint64_t from = begin > ts ? (begin - ts + tick_diff - 1) / tick_diff : 0;               // NOLINT
+      const uint64_t to = std::min<uint64_t>(m_frames_per_element, (end - ts + tick_diff - 1) / tick_diff); // NOLINT
+      if (from < to) {
+        auto data = reinterpret_cast<char*>(&m_buffer[index % m_capacity]);
+        pieces.emplace_back(data + from * m_frame_size, (to - from) * m_frame_size);
+      }
+    }
+  }
+  auto fragment = std::make_unique<daqdataformats::Fragment>(pieces);
+
+  // The consumer may have reused the oldest slots while they were copied
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t written = m_written.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+  const bool overwritten = written >= first + m_capacity;
+  const bool complete = arrived && !pieces.empty() && !overwritten && timestamp(first) <= begin;
+  if (overwritten) {
+    m_overwritten.fetch_add(written - (first + m_capacity) + 1, std::memory_order_relaxed);
+    fragment = std::make_unique<daqdataformats::Fragment>(std::vector<std::pair<void*, size_t>>());
+  }
+
+  daqdataformats::FragmentHeader header;
+  header.trigger_number = request.trigger_number;
+  header.trigger_timestamp = request.trigger_timestamp;
+  header.window_begin = begin;
+  header.window_end = end;
+  header.run_number = request.run_number;
+  header.sequence_number = request.sequence_number;
+  header.element_id = m_sourceid;
+  header.fragment_type = static_cast<daqdataformats::fragment_type_t>(element_t::fragment_type);
+  if (!complete) {
+    header.error_bits |= (0x1 << static_cast<size_t>(daqdataformats::FragmentErrorBits::kDataNotFound));
+    m_data_not_found.fetch_add(1, std::memory_order_relaxed);
+  }
+  fragment->set_header_fields(header);
+  stage_end(m_instrumented, m_histograms.request_lookup, start);
+  send_fragment(request, std::move(fragment));
+  return true;
+}
+
+template<class ReadoutType>
+std::size_t
+ReferenceReadoutModel<ReadoutType>::serve_pending(bool last_attempt)
+{
+  std::size_t served = 0;
+  const auto now = std::chrono::steady_clock::now();
+  for (auto pending = m_pending.begin(); pending != m_pending.end();) {
+    if (try_serve(pending->request, last_attempt || now >= pending->deadline)) {
+      pending = m_pending.erase(pending);
+      ++served;
+    } else {
+      ++pending;
+    }
+  }
+  return served;
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::send_fragment(const dfmessages::DataRequest& request,
+                                                  std::unique_ptr<daqdataformats::Fragment> fragment)
+{
+  const uint64_t start = stage_start(m_instrumented); // NOLINT(build/unsigned)
+  try {
+    get_iom_sender<std::unique_ptr<daqdataformats::Fragment>>(request.data_destination)
+      ->send(std::move(fragment), m_source_queue_timeout_ms);
+    stage_end(m_instrumented, m_histograms.fragment_send, start);
+    m_fragments.fetch_add(1, std::memory_order_relaxed);
+  } catch (const ers::Issue& excpt) {
+    ers::warning(CannotWriteToQueue(ERS_HERE, m_sourceid, request.data_destination, excpt));
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::send_timesync()
+{
+  const uint64_t written = m_written.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+  if (m_timesync_sender == nullptr || written == 0) {
+    return;
+  }
+  dfmessages::TimeSync timesync(m_buffer[(written - 1) % m_capacity].get_first_timestamp());
+  timesync.run_number = m_run_number;
+  timesync.sequence_number = ++m_timesync_seqno;
+  timesync.source_pid = m_pid;
+  // A late timesync is superseded by the next one, never wait for it
+  if (m_timesync_sender->try_send(std::move(timesync), iomanager::timeout_t(0))) {
+    m_timesyncs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+template<class ReadoutType>
+void
+ReferenceReadoutModel<ReadoutType>::join_threads()
+{
+  for (auto thread : { &m_consumer_thread, &m_request_thread, &m_timesync_thread }) {
+    if (thread->joinable()) {
+      thread->join();
+    }
+  }
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
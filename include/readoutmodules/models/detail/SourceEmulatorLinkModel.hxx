@@ -0,0 +1,399 @@
+// Declarations for SourceEmulatorLinkModel
+
+namespace dunedaq {
+namespace readoutmodules {
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::set_sender(const std::string& conn_name)
+{
+  if (!m_is_configured) {
+    m_conn_uid = conn_name;
+    m_raw_data_sender = get_iom_sender<ReadoutType>(conn_name);
+  }
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::conf(const nlohmann::json& args, const nlohmann::json& link_conf)
+{
+  if (m_is_configured) {
+    TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS) << "This emulator is already configured!";
+    return;
+  }
+  m_conf = args.get<module_conf_t>();
+  m_link_conf = link_conf.get<link_conf_t>();
+  m_sourceid.id = m_link_conf.source_id;
+  m_sourceid.subsystem = ReadoutType::subsystem;
+  m_sink_queue_timeout_ms = iomanager::timeout_t(m_conf.queue_timeout_ms);
+  m_ext_conf = args.get<ext_conf_t>();
+
+  if (m_ext_conf.source_mode == fakecardreaderconfig::SourceMode::replay) {
+    if (m_replay_clock == nullptr) {
+      throw ConfigurationError(ERS_HERE, m_sourceid, "No replay clock bound to emulator " + m_name);
+    }
+    // The recording is streamed, only its first element is read here to align the links
+    m_reader = std::make_unique<SequentialFileReader>(get_source_filename(m_link_conf), m_ext_conf.replay_read_buffer_size);
+    if (!m_reader->read(&m_payload, sizeof(ReadoutType))) {
+      throw EmptySourceBuffer(ERS_HERE, m_sourceid, m_reader->get_filename());
+    }
+    m_replay_clock->register_first_timestamp(m_payload.get_first_timestamp());
+    m_num_frames = m_payload.get_num_frames();
+    m_reader->rewind();
+  } else if (m_ext_conf.source_mode == fakecardreaderconfig::SourceMode::generator) {
+    if constexpr (FrameGeneratorTraits<ReadoutType>::available) {
+      using traits_t = FrameGeneratorTraits<ReadoutType>;
+      // Samples of a channel are time_tick_diff ticks apart
+      const double pulse_probability =
+        m_ext_conf.generator_pulse_rate_hz * m_time_tick_diff / m_ext_conf.clock_speed_hz;
+      m_generator = std::make_unique<AdcNoiseGenerator>();
+      m_generator->conf(m_ext_conf.generator_pedestal,
+                        m_ext_conf.generator_noise_rms,
+                        traits_t::adc_bits,
+                        pulse_probability,
+                        static_cast<uint16_t>(m_ext_conf.generator_pulse_amplitude), // NOLINT(build/unsigned)
+                        m_ext_conf.generator_seed ^ (m_link_conf.source_id * 0x9e3779b97f4a7c15ULL));
+      m_adcs.resize(traits_t::samples_per_element * traits_t::num_channels);
+      m_simd_level = simd_level_name(m_generator->get_simd_level());
+    } else {
+      throw ConfigurationError(ERS_HERE, m_sourceid, "No frame generator available for the data type of " + m_name);
+    }
+  } else {
+    if (m_source_buffer == nullptr) {
+      throw ConfigurationError(ERS_HERE, m_sourceid, "No source buffer bound to emulator " + m_name);
+    }
+    if (m_source_buffer->num_elements(sizeof(ReadoutType)) == 0) {
+      throw EmptySourceBuffer(ERS_HERE, m_sourceid, m_source_buffer->get_filename());
+    }
+  }
+
+  // TP links keep their queue, their handlers are not in the same process in general
+  if (m_ext_conf.transport == fakecardreaderconfig::Transport::in_process_ring && !m_is_tp_link) {
+    m_ring = InProcessRingRegistry::get().acquire<ReadoutType>(
+      m_conn_uid, ring_slots(m_ext_conf.ring_capacity, batch_size_of<ReadoutType>::value));
+    if (m_source_buffer != nullptr) {
+      m_ring->keep_alive(m_source_buffer);
+    }
+    if (m_generator != nullptr) {
+      // Generated elements are packed in place, their headers must start zeroed like m_payload
+      m_ring->zero_elements();
+    }
+    TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS)
+      << "Emulator " << m_name << " writes into the in-process ring " << m_conn_uid << " of " << m_ring->capacity()
+      << " slots";
+  }
+
+  const double rate_khz = m_rate_khz / m_link_conf.slowdown / batch_size_of<ReadoutType>::value;
+  m_rate_limiter = std::make_unique<readoutlibs::RateLimiter>(rate_khz);
+  m_period_ns = 1e6 / rate_khz;
+
+  if (m_reader != nullptr) {
+    TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS)
+      << "Emulator " << m_name << " replays " << m_reader->get_filename() << " at " << m_ext_conf.replay_speed
+      << "x its recorded timing";
+  } else if (m_generator != nullptr) {
+    TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS)
+      << "Emulator " << m_name << " generates data at " << rate_khz << " kHz with the " << m_simd_level
+      << " noise kernel";
+  } else {
+    TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS)
+      << "Emulator " << m_name << " replays " << m_source_buffer->num_elements(sizeof(ReadoutType))
+      << " elements from " << m_source_buffer->get_filename() << " at " << rate_khz << " kHz";
+  }
+
+  m_is_configured = true;
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::scrap(const nlohmann::json& /*args*/)
+{
+  m_source_buffer = nullptr;
+  m_ring.reset();
+  m_replay_clock = nullptr;
+  m_reader.reset();
+  m_rate_limiter.reset();
+  m_generator.reset();
+  m_simd_level.clear();
+  m_adcs.clear();
+  m_engine_driven = false;
+  m_is_configured = false;
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::start(const nlohmann::json& /*args*/)
+{
+  m_packet_count = 0;
+  m_output_blocked = false;
+  m_rate_scale = 1.;
+  m_last_info_time = std::chrono::steady_clock::now();
+  if (m_reader != nullptr) {
+    m_reader->rewind();
+    m_producer_thread.set_name("fakereplay", m_link_conf.source_id);
+    m_producer_thread.set_work(&SourceEmulatorLinkModel<ReadoutType>::run_replay, this);
+    return;
+  }
+  prepare_produce();
+  if (!m_engine_driven) {
+    m_producer_thread.set_name("fakeprod", m_link_conf.source_id);
+    m_producer_thread.set_work(&SourceEmulatorLinkModel<ReadoutType>::run_produce, this);
+  }
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::stop(const nlohmann::json& /*args*/)
+{
+  while (!m_producer_thread.get_readiness()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+{
+  auto now = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(now - m_last_info_time).count();
+  m_last_info_time = now;
+
+  emulatorlinkinfo::Info info;
+  info.packets = m_packet_count_tot.load();
+  info.new_packets = m_packet_count.exchange(0);
+  info.rate_scale = m_rate_scale.load(std::memory_order_relaxed);
+  info.rate_khz = m_is_configured ? get_nominal_rate_khz() * info.rate_scale : 0.;
+  info.achieved_rate_khz = seconds > 0. ? info.new_packets / seconds / 1000. : 0.;
+  info.send_failures = m_send_failures.load();
+  info.simd_level = m_simd_level;
+
+  opmonlib::InfoCollector link_ci;
+  link_ci.add(info);
+  ci.add(m_name, link_ci);
+}
+
+template<class ReadoutType>
+EmulatedLinkHealth
+SourceEmulatorLinkModel<ReadoutType>::get_link_health() const
+{
+  EmulatedLinkHealth health;
+  health.sent = m_packet_count_tot.load(std::memory_order_relaxed);
+  health.send_failures = m_send_failures.load(std::memory_order_relaxed);
+  if (m_ring != nullptr) {
+    health.fill = static_cast<double>(m_ring->occupancy()) / m_ring->capacity();
+  }
+  return health;
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::prepare_produce()
+{
+  m_offset = 0;
+
+  if (m_generator != nullptr) {
+    // Synthesized elements start from zeroed headers and from t0, if given
+    std::memset(static_cast<void*>(&m_payload), 0, sizeof(ReadoutType));
+    m_num_frames = m_payload.get_num_frames();
+    m_timestamp = (m_conf.set_t0_to >= 0) ? m_conf.set_t0_to : 0;
+    return;
+  }
+
+  m_num_elem = m_source_buffer->num_elements(sizeof(ReadoutType));
+
+  // The first element of the buffer gives the frame count and, unless overridden, the initial timestamp
+  std::memcpy(static_cast<void*>(&m_payload), m_source_buffer->data(), sizeof(ReadoutType));
+  m_num_frames = m_payload.get_num_frames();
+  m_timestamp = (m_conf.set_t0_to >= 0) ? m_conf.set_t0_to : m_payload.get_first_timestamp();
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::generate(ReadoutType& element)
+{
+  if constexpr (FrameGeneratorTraits<ReadoutType>::available) {
+    using traits_t = FrameGeneratorTraits<ReadoutType>;
+    m_generator->fill(m_adcs.data(), traits_t::samples_per_element, traits_t::num_channels);
+    traits_t::pack(m_adcs.data(), element);
+  }
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::drop_element()
+{
+  m_send_failures++;
+  // Warn once per stretch of full output, an engine-driven link would warn at its full rate
+  if (!m_output_blocked) {
+    m_output_blocked = true;
+    ers::warning(CannotWriteToQueue(ERS_HERE, m_sourceid, m_conn_uid));
+  }
+}
+
+template<class ReadoutType>
+typename InProcessRing<ReadoutType>::slot_t*
+SourceEmulatorLinkModel<ReadoutType>::wait_ring_slot()
+{
+  auto* slot = m_ring->write_slot();
+  if (slot != nullptr) {
+    m_output_blocked = false;
+    return slot;
+  }
+  if (m_engine_driven) {
+    // The engine thread drives other links too, it must not wait for this one
+    drop_element();
+    return nullptr;
+  }
+  const auto deadline = std::chrono::steady_clock::now() + m_sink_queue_timeout_ms;
+  while ((slot = m_ring->write_slot()) == nullptr) {
+    if (!m_run_marker.load() || std::chrono::steady_clock::now() >= deadline) {
+      m_send_failures++;
+      ers::warning(CannotWriteToQueue(ERS_HERE, m_sourceid, m_conn_uid));
+      return nullptr;
+    }
+    std::this_thread::yield();
+  }
+  return slot;
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::send(ReadoutType& payload)
+{
+  if (m_ring != nullptr) {
+    auto* slot = wait_ring_slot();
+    if (slot != nullptr) {
+      std::memcpy(static_cast<void*>(&slot->element), &payload, sizeof(ReadoutType));
+      slot->data = &slot->element;
+      slot->is_descriptor = false;
+      m_ring->commit();
+    }
+    return;
+  }
+
+  if (m_engine_driven) {
+    if (m_raw_data_sender->try_send(std::move(payload), iomanager::timeout_t(0))) {
+      m_output_blocked = false;
+    } else {
+      drop_element();
+    }
+    return;
+  }
+  try {
+    m_raw_data_sender->send(std::move(payload), m_sink_queue_timeout_ms);
+  } catch (const ers::Issue& excpt) {
+    m_send_failures++;
+    ers::warning(CannotWriteToQueue(ERS_HERE, m_sourceid, m_name, excpt));
+  }
+}
+
+template<class ReadoutType>
+double
+SourceEmulatorLinkModel<ReadoutType>::produce_next()
+{
+  if (m_ring == nullptr) {
+    if (m_generator != nullptr) {
+      generate(m_payload);
+    } else {
+      // Frames are copied out of the read-only buffer before their timestamps are faked
+      std::memcpy(static_cast<void*>(&m_payload), source_element(), sizeof(ReadoutType));
+    }
+    m_payload.fake_timestamps(m_timestamp, m_time_tick_diff);
+    send(m_payload);
+  } else if (auto* slot = wait_ring_slot(); slot != nullptr) {
+    // Nothing is copied on this side: synthesized elements are packed in place and elements of
+    // the source buffer are passed by reference, the consumer fakes their timestamps as it copies them
+    if (m_generator != nullptr) {
+      generate(slot->element);
+      slot->element.fake_timestamps(m_timestamp, m_time_tick_diff);
+      slot->data = &slot->element;
+      slot->is_descriptor = false;
+    } else {
+      slot->data = source_element();
+      slot->first_timestamp = m_timestamp;
+      slot->tick_diff = m_time_tick_diff;
+      slot->is_descriptor = true;
+    }
+    m_ring->commit();
+  }
+
+  if (m_generator == nullptr && ++m_offset == m_num_elem) {
+    m_offset = 0;
+  }
+
+  m_packet_count++;
+  m_packet_count_tot++;
+
+  m_timestamp += m_time_tick_diff * m_num_frames;
+  return m_period_ns / m_rate_scale.load(std::memory_order_relaxed);
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::run_produce()
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS) << "Data generator thread " << m_name << " started";
+
+  double applied_scale = 0.;
+  m_rate_limiter->init();
+  while (m_run_marker.load()) {
+    const double scale = m_rate_scale.load(std::memory_order_relaxed);
+    if (scale != applied_scale) {
+      m_rate_limiter->adjust(get_nominal_rate_khz() * scale);
+      applied_scale = scale;
+    }
+    produce_next();
+    m_rate_limiter->limit();
+  }
+
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS) << "Data generator thread " << m_name << " finished";
+}
+
+template<class ReadoutType>
+void
+SourceEmulatorLinkModel<ReadoutType>::run_replay()
+{
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS) << "Replay thread " << m_name << " started";
+
+  // Looping over the recording shifts the timestamps by its span, so that they keep increasing
+  uint64_t first_timestamp = 0; // NOLINT(build/unsigned)
+  uint64_t last_timestamp = 0;  // NOLINT(build/unsigned)
+  uint64_t loop_offset = 0;     // NOLINT(build/unsigned)
+  bool first = true;
+
+  while (m_run_marker.load()) {
+    if (!m_reader->read(&m_payload, sizeof(ReadoutType))) {
+      if (!m_ext_conf.replay_loop) {
+        TLOG() << "Emulator " << m_name << " reached the end of " << m_reader->get_filename();
+        break;
+      }
+      loop_offset += last_timestamp + m_time_tick_diff * m_num_frames - first_timestamp;
+      m_reader->rewind();
+      continue;
+    }
+
+    uint64_t timestamp = m_payload.get_first_timestamp(); // NOLINT(build/unsigned)
+    if (first) {
+      first_timestamp = timestamp;
+      first = false;
+    }
+    last_timestamp = timestamp;
+    if (loop_offset != 0) {
+      m_payload.fake_timestamps(timestamp + loop_offset, m_time_tick_diff);
+    }
+
+    if (!TscClock::wait_until(m_replay_clock->tsc_at(timestamp + loop_offset), m_run_marker)) {
+      break;
+    }
+
+    send(m_payload);
+
+    m_packet_count++;
+    m_packet_count_tot++;
+  }
+
+  TLOG_DEBUG(dunedaq::readoutlibs::logging::TLVL_WORK_STEPS) << "Replay thread " << m_name << " finished";
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
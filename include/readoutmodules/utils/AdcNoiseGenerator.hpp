@@ -0,0 +1,290 @@
+/**
+ * @file AdcNoiseGenerator.hpp Synthesizes ADC samples: a pedestal with
+ * approximately gaussian noise (sum of four uniforms) and sparse pulses
+ * at a given rate per channel. The noise kernel is built for several
+ * instruction sets and picked at conf() for the running CPU.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_ADCNOISEGENERATOR_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_ADCNOISEGENERATOR_HPP_
+
+#include "readoutmodules/utils/SimdLevel.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class AdcNoiseGenerator
+{
+public:
+  /**
+   * @brief Configure the generated signal
+   * @param pedestal Baseline ADC value
+   * @param noise_rms RMS of the noise around the pedestal, in ADC counts
+   * @param adc_bits Resolution of the ADCs, samples are clamped to it
+   * @param pulse_probability Probability of a pulse starting on a given sample of a given channel
+   * @param pulse_amplitude Peak height of the pulses above the pedestal
+   * @param seed Seed of the random streams, use different ones for different links
+   * @param simd_level Widest noise kernel to use, lowered to what the CPU supports
+   */
+  void conf(double pedestal,
+            double noise_rms,
+            unsigned adc_bits,
+            double pulse_probability,
+            uint16_t pulse_amplitude, // NOLINT(build/unsigned)
+            uint64_t seed,            // NOLINT(build/unsigned)
+            SimdLevel simd_level = SimdLevel::avx512)
+  {
+    m_simd_level = supported_simd_level(simd_level);
+    switch (m_simd_level) {
+      case SimdLevel::avx512:
+        m_noise_kernel = &AdcNoiseGenerator::fill_noise_avx512;
+        break;
+      case SimdLevel::avx2:
+        m_noise_kernel = &AdcNoiseGenerator::fill_noise_avx2;
+        break;
+      case SimdLevel::sse42:
+        m_noise_kernel = &AdcNoiseGenerator::fill_noise_sse42;
+        break;
+      default:
+        m_noise_kernel = nullptr;
+    }
+
+    m_max_adc = static_cast<int16_t>(adc_bits >= 15 ? std::numeric_limits<int16_t>::max() : (1 << adc_bits) - 1);
+    m_pedestal = static_cast<int16_t>(std::clamp(std::lround(pedestal), 0l, static_cast<long>(m_max_adc))); // NOLINT
+    m_scale_q15 = static_cast<int16_t>(std::min(std::lround(noise_rms / s_sum_sigma * 32768.), 32767l));     // NOLINT
+    m_pulse_probability = pulse_probability;
+    m_pulse_amplitude = pulse_amplitude;
+
+    for (auto& lane : m_state[0]) {
+      lane = splitmix64(seed);
+    }
+    for (auto& lane : m_state[1]) {
+      lane = splitmix64(seed);
+    }
+    m_scalar_state[0] = splitmix64(seed);
+    m_scalar_state[1] = splitmix64(seed);
+    m_next_pulse = draw_pulse_gap();
+  }
+
+  /**
+   * @brief Fill samples x channels ADC values, sample-major
+   */
+  void fill(uint16_t* adcs, std::size_t samples, std::size_t channels) // NOLINT(build/unsigned)
+  {
+    const std::size_t count = samples * channels;
+    std::size_t done = (m_noise_kernel != nullptr) ? (this->*m_noise_kernel)(adcs, count) : 0;
+    fill_noise_scalar(adcs + done, count - done);
+    add_pulses(adcs, count, channels);
+  }
+
+  //! The noise kernel picked at conf()
+  SimdLevel get_simd_level() const { return m_simd_level; }
+
+private:
+  using noise_kernel_t = std::size_t (AdcNoiseGenerator::*)(uint16_t*, std::size_t); // NOLINT(build/unsigned)
+
+  static uint64_t splitmix64(uint64_t& x) // NOLINT(build/unsigned)
+  {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL); // NOLINT(build/unsigned)
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  uint64_t next_scalar() // NOLINT(build/unsigned)
+  {
+    uint64_t s1 = m_scalar_state[0];       // NOLINT(build/unsigned)
+    const uint64_t s0 = m_scalar_state[1]; // NOLINT(build/unsigned)
+    m_scalar_state[0] = s0;
+    s1 ^= s1 << 23;
+    m_scalar_state[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+    return m_scalar_state[1] + s0;
+  }
+
+  int16_t noise_sample(uint64_t r) const // NOLINT(build/unsigned)
+  {
+    // Four 14-bit uniforms summed, centered, and scaled like _mm256_mulhrs_epi16
+    int32_t sum = static_cast<int32_t>((r & 0x3fff) + ((r >> 16) & 0x3fff) + ((r >> 32) & 0x3fff) + ((r >> 48) & 0x3fff));
+    int32_t noise = ((sum - s_sum_mean) * m_scale_q15 + (1 << 14)) >> 15;
+    return static_cast<int16_t>(std::clamp(m_pedestal + noise, 0, static_cast<int32_t>(m_max_adc)));
+  }
+
+  void fill_noise_scalar(uint16_t* adcs, std::size_t count) // NOLINT(build/unsigned)
+  {
+    for (std::size_t i = 0; i < count; ++i) {
+      adcs[i] = static_cast<uint16_t>(noise_sample(next_scalar())); // NOLINT(build/unsigned)
+    }
+  }
+
+  // The vector kernels run xorshift128+ on 64-bit lanes; four steps give
+  // four 14-bit uniforms per 16-bit output lane, which are summed and scaled
+  // like noise_sample(). Each kernel returns the number of values it filled.
+
+  __attribute__((target("sse4.2"))) std::size_t fill_noise_sse42(uint16_t* adcs, std::size_t count) // NOLINT
+  {
+    __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_state[0]));
+    __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_state[1]));
+    const __m128i mask14 = _mm_set1_epi16(0x3fff);
+    const __m128i mean = _mm_set1_epi16(static_cast<int16_t>(s_sum_mean));
+    const __m128i scale = _mm_set1_epi16(m_scale_q15);
+    const __m128i pedestal = _mm_set1_epi16(m_pedestal);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max_adc = _mm_set1_epi16(m_max_adc);
+
+    auto next = [&s0, &s1]() __attribute__((target("sse4.2"))) {
+      __m128i x = s0;
+      const __m128i y = s1;
+      s0 = y;
+      x = _mm_xor_si128(x, _mm_slli_epi64(x, 23));
+      s1 = _mm_xor_si128(_mm_xor_si128(x, y), _mm_xor_si128(_mm_srli_epi64(x, 17), _mm_srli_epi64(y, 26)));
+      return _mm_add_epi64(s1, y);
+    };
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      __m128i sum = _mm_and_si128(next(), mask14);
+      sum = _mm_add_epi16(sum, _mm_and_si128(next(), mask14));
+      sum = _mm_add_epi16(sum, _mm_and_si128(next(), mask14));
+      sum = _mm_add_epi16(sum, _mm_and_si128(next(), mask14));
+      __m128i noise = _mm_mulhrs_epi16(_mm_sub_epi16(sum, mean), scale);
+      __m128i adc = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(pedestal, noise), zero), max_adc);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(adcs + i), adc);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(m_state[0]), s0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(m_state[1]), s1);
+    return i;
+  }
+
+  __attribute__((target("avx2"))) std::size_t fill_noise_avx2(uint16_t* adcs, std::size_t count) // NOLINT
+  {
+    __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_state[0]));
+    __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_state[1]));
+    const __m256i mask14 = _mm256_set1_epi16(0x3fff);
+    const __m256i mean = _mm256_set1_epi16(static_cast<int16_t>(s_sum_mean));
+    const __m256i scale = _mm256_set1_epi16(m_scale_q15);
+    const __m256i pedestal = _mm256_set1_epi16(m_pedestal);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max_adc = _mm256_set1_epi16(m_max_adc);
+
+    auto next = [&s0, &s1]() __attribute__((target("avx2"))) {
+      __m256i x = s0;
+      const __m256i y = s1;
+      s0 = y;
+      x = _mm256_xor_si256(x, _mm256_slli_epi64(x, 23));
+      s1 = _mm256_xor_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(_mm256_srli_epi64(x, 17), _mm256_srli_epi64(y, 26)));
+      return _mm256_add_epi64(s1, y);
+    };
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+      __m256i sum = _mm256_and_si256(next(), mask14);
+      sum = _mm256_add_epi16(sum, _mm256_and_si256(next(), mask14));
+      sum = _mm256_add_epi16(sum, _mm256_and_si256(next(), mask14));
+      sum = _mm256_add_epi16(sum, _mm256_and_si256(next(), mask14));
+      __m256i noise = _mm256_mulhrs_epi16(_mm256_sub_epi16(sum, mean), scale);
+      __m256i adc = _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(pedestal, noise), zero), max_adc);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(adcs + i), adc);
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_state[0]), s0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_state[1]), s1);
+    return i;
+  }
+
+  __attribute__((target("avx512f,avx512bw"))) std::size_t fill_noise_avx512(uint16_t* adcs, std::size_t count) // NOLINT
+  {
+    __m512i s0 = _mm512_loadu_si512(m_state[0]);
+    __m512i s1 = _mm512_loadu_si512(m_state[1]);
+    const __m512i mask14 = _mm512_set1_epi16(0x3fff);
+    const __m512i mean = _mm512_set1_epi16(static_cast<int16_t>(s_sum_mean));
+    const __m512i scale = _mm512_set1_epi16(m_scale_q15);
+    const __m512i pedestal = _mm512_set1_epi16(m_pedestal);
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i max_adc = _mm512_set1_epi16(m_max_adc);
+
+    // Zero-masked shifts on all lanes are plain shifts, the unmasked forms trip
+    // a false maybe-uninitialized warning in the GCC 12 headers
+    auto next = [&s0, &s1]() __attribute__((target("avx512f,avx512bw"))) {
+      __m512i x = s0;
+      const __m512i y = s1;
+      s0 = y;
+      x = _mm512_xor_si512(x, _mm512_maskz_slli_epi64(0xff, x, 23));
+      s1 = _mm512_xor_si512(_mm512_xor_si512(x, y),
+                            _mm512_xor_si512(_mm512_maskz_srli_epi64(0xff, x, 17), _mm512_maskz_srli_epi64(0xff, y, 26)));
+      return _mm512_add_epi64(s1, y);
+    };
+
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+      __m512i sum = _mm512_and_si512(next(), mask14);
+      sum = _mm512_add_epi16(sum, _mm512_and_si512(next(), mask14));
+      sum = _mm512_add_epi16(sum, _mm512_and_si512(next(), mask14));
+      sum = _mm512_add_epi16(sum, _mm512_and_si512(next(), mask14));
+      __m512i noise = _mm512_mulhrs_epi16(_mm512_sub_epi16(sum, mean), scale);
+      __m512i adc = _mm512_min_epi16(_mm512_max_epi16(_mm512_add_epi16(pedestal, noise), zero), max_adc);
+      _mm512_storeu_si512(adcs + i, adc);
+    }
+
+    _mm512_storeu_si512(m_state[0], s0);
+    _mm512_storeu_si512(m_state[1], s1);
+    return i;
+  }
+
+  // Distance in samples to the next pulse start, geometrically distributed
+  std::size_t draw_pulse_gap()
+  {
+    if (m_pulse_probability <= 0.) {
+      return std::numeric_limits<std::size_t>::max();
+    }
+    double u = (static_cast<double>(next_scalar() >> 11) + 0.5) * 0x1.0p-53;
+    return static_cast<std::size_t>(std::log(u) / std::log1p(-std::min(m_pulse_probability, 0.5)));
+  }
+
+  // Pulses rise to their amplitude and decay by half on every following sample of the channel
+  void add_pulses(uint16_t* adcs, std::size_t count, std::size_t channels) // NOLINT(build/unsigned)
+  {
+    if (m_pulse_probability <= 0.) {
+      return;
+    }
+    while (m_next_pulse < count) {
+      int32_t height = m_pulse_amplitude;
+      for (std::size_t i = m_next_pulse; i < count && height > 0; i += channels, height >>= 1) {
+        adcs[i] = static_cast<uint16_t>(std::min<int32_t>(adcs[i] + height, m_max_adc)); // NOLINT(build/unsigned)
+      }
+      m_next_pulse += 1 + draw_pulse_gap();
+    }
+    m_next_pulse -= count;
+  }
+
+  // Mean and standard deviation of a sum of four uniform 14-bit values
+  static constexpr int32_t s_sum_mean = 2 * 16383;
+  static constexpr double s_sum_sigma = 9459.4;
+
+  // Lanes of the widest kernel, narrower ones use the first lanes
+  alignas(64) uint64_t m_state[2][8]; // NOLINT(build/unsigned)
+  uint64_t m_scalar_state[2];         // NOLINT(build/unsigned)
+  int16_t m_pedestal = 0;
+  int16_t m_scale_q15 = 0;
+  int16_t m_max_adc = 0;
+  double m_pulse_probability = 0.;
+  uint16_t m_pulse_amplitude = 0; // NOLINT(build/unsigned)
+  std::size_t m_next_pulse = 0;
+  SimdLevel m_simd_level = SimdLevel::scalar;
+  noise_kernel_t m_noise_kernel = nullptr;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_ADCNOISEGENERATOR_HPP_
@@ -0,0 +1,146 @@
+/**
+ * @file FrameBatch.hpp A fixed number of consecutive readout elements moved
+ * between the fake card and the data link handler as one queue element.
+ * Readouts implementing BatchedInputReadoutConcept unpack the batches into
+ * their latency buffer (see batch_element_of), which keeps single elements.
+ * A batch also provides the readout type interface itself, for the fake
+ * card. Elements must be laid out as back-to-back frames, like the
+ * superchunks.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_FRAMEBATCH_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_FRAMEBATCH_HPP_
+
+#include "readoutmodules/utils/FrameGeneratorTraits.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+template<class ReadoutType, std::size_t BatchSize>
+struct FrameBatch
+{
+  static_assert(BatchSize > 0, "A batch holds at least one element");
+
+  bool operator<(const FrameBatch& other) const { return elements[0] < other.elements[0]; }
+
+  uint64_t get_first_timestamp() const { return elements[0].get_first_timestamp(); } // NOLINT(build/unsigned)
+  void set_first_timestamp(uint64_t ts) { elements[0].set_first_timestamp(ts); }      // NOLINT(build/unsigned)
+  uint64_t get_timestamp() const { return elements[0].get_timestamp(); }             // NOLINT(build/unsigned)
+  void set_timestamp(uint64_t ts) { elements[0].set_timestamp(ts); }                  // NOLINT(build/unsigned)
+
+  void fake_timestamps(uint64_t first_timestamp, uint64_t offset = ReadoutType::expected_tick_difference) // NOLINT
+  {
+    for (std::size_t i = 0; i < BatchSize; ++i) {
+      elements[i].fake_timestamps(first_timestamp, offset);
+      first_timestamp += elements[i].get_num_frames() * offset;
+    }
+  }
+  void fake_frame_errors(std::vector<uint16_t>* fake_errors) // NOLINT(build/unsigned)
+  {
+    for (auto& element : elements) {
+      element.fake_frame_errors(fake_errors);
+    }
+  }
+
+  // Frames of consecutive elements are contiguous
+  auto begin() { return elements[0].begin(); }
+  auto end() { return elements[BatchSize - 1].end(); }
+
+  std::size_t get_payload_size() { return BatchSize * elements[0].get_payload_size(); }
+  std::size_t get_num_frames() { return BatchSize * elements[0].get_num_frames(); }
+  std::size_t get_frame_size() { return elements[0].get_frame_size(); }
+
+  static const constexpr auto subsystem = ReadoutType::subsystem;
+  static const constexpr auto fragment_type = ReadoutType::fragment_type;
+  static const constexpr uint64_t expected_tick_difference = ReadoutType::expected_tick_difference; // NOLINT
+
+  ReadoutType elements[BatchSize];
+};
+
+//! Number of elements moved at once: BatchSize for batches, 1 otherwise
+template<class ReadoutType>
+struct batch_size_of : std::integral_constant<std::size_t, 1>
+{};
+
+template<class ReadoutType, std::size_t BatchSize>
+struct batch_size_of<FrameBatch<ReadoutType, BatchSize>> : std::integral_constant<std::size_t, BatchSize>
+{};
+
+//! Element type carried by a queue element, and where its elements are
+template<class ReadoutType>
+struct batch_element_of
+{
+  using type = ReadoutType;
+  static const ReadoutType* elements(const ReadoutType& input) { return &input; }
+};
+
+template<class ReadoutType, std::size_t BatchSize>
+struct batch_element_of<FrameBatch<ReadoutType, BatchSize>>
+{
+  using type = ReadoutType;
+  static const ReadoutType* elements(const FrameBatch<ReadoutType, BatchSize>& input) { return input.elements; }
+};
+
+//! Batches can be synthesized when their elements can
+template<class ReadoutType, std::size_t BatchSize>
+struct FrameGeneratorTraits<FrameBatch<ReadoutType, BatchSize>>
+{
+  using element_traits_t = FrameGeneratorTraits<ReadoutType>;
+
+  static constexpr bool available = element_traits_t::available;
+  static constexpr std::size_t num_channels = element_traits_t::num_channels;
+  static constexpr std::size_t samples_per_element = element_traits_t::samples_per_element * BatchSize;
+  static constexpr unsigned adc_bits = element_traits_t::adc_bits;
+
+  static void pack(const uint16_t* adcs, FrameBatch<ReadoutType, BatchSize>& batch) // NOLINT(build/unsigned)
+  {
+    for (std::size_t i = 0; i < BatchSize; ++i) {
+      element_traits_t::pack(adcs + i * element_traits_t::samples_per_element * num_channels, batch.elements[i]);
+    }
+  }
+};
+
+//! Tag carrying the readout type to instantiate for a batch size
+template<class ReadoutType>
+struct batch_tag
+{
+  using type = ReadoutType;
+};
+
+/**
+ * @brief Instantiate a readout or emulator for the configured batch size
+ *
+ * make is called with batch_tag<ReadoutType> for a batch size of 1, and with
+ * batch_tag<FrameBatch<ReadoutType, N>> for the supported sizes N = 4, 16
+ * and 64. Other sizes return an empty pointer.
+ */
+template<class ReadoutType, class Make>
+auto
+make_batched(std::size_t batch_size, Make&& make) -> decltype(make(batch_tag<ReadoutType>{}))
+{
+  switch (batch_size) {
+    case 1:
+      return make(batch_tag<ReadoutType>{});
+    case 4:
+      return make(batch_tag<FrameBatch<ReadoutType, 4>>{});
+    case 16:
+      return make(batch_tag<FrameBatch<ReadoutType, 16>>{});
+    case 64:
+      return make(batch_tag<FrameBatch<ReadoutType, 64>>{});
+    default:
+      return nullptr;
+  }
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_FRAMEBATCH_HPP_
@@ -0,0 +1,129 @@
+/**
+ * @file FrameGeneratorTraits.hpp Describes how synthesized ADC samples are
+ * laid out in a readout type. Frontend packages specialize
+ * FrameGeneratorTraits for their types to enable the generator source mode,
+ * usually through PackedAdcGeneratorTraits.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_FRAMEGENERATORTRAITS_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_FRAMEGENERATORTRAITS_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+namespace detail {
+
+// Places value J of a group into the group's words; shifts are compile-time constants
+template<unsigned Bits, std::size_t J>
+inline void
+pack_adc(const uint16_t* adcs, uint64_t* packed) // NOLINT(build/unsigned)
+{
+  constexpr std::size_t bit = J * Bits;
+  const uint64_t adc = adcs[J] & ((1ULL << Bits) - 1); // NOLINT(build/unsigned)
+  packed[bit / 64] |= adc << (bit % 64);
+  if constexpr (bit % 64 + Bits > 64) {
+    packed[bit / 64 + 1] |= adc >> (64 - bit % 64);
+  }
+}
+
+template<unsigned Bits, std::size_t... J>
+inline void
+pack_group(const uint16_t* adcs, uint64_t* packed, std::index_sequence<J...>) // NOLINT(build/unsigned)
+{
+  (pack_adc<Bits, J>(adcs, packed), ...);
+}
+
+} // namespace detail
+
+/**
+ * @brief Pack Count ADC values of Bits bits each, contiguously and least significant bit first
+ *
+ * Values are handled in groups that fill a whole number of 64-bit words, so
+ * that every group is a fixed, fully unrolled sequence of shifts and ors.
+ */
+template<unsigned Bits, std::size_t Count>
+inline void
+pack_adcs(const uint16_t* adcs, uint8_t* dst) // NOLINT(build/unsigned)
+{
+  static_assert(Bits > 0 && Bits <= 16, "ADC values are at most 16 bits wide");
+  if constexpr (Bits == 16) {
+    std::memcpy(dst, adcs, Count * sizeof(uint16_t)); // NOLINT(build/unsigned)
+  } else {
+    constexpr std::size_t group = 64 / std::gcd(64u, Bits); // values per group
+    constexpr std::size_t words = group * Bits / 64;        // words per group
+
+    std::size_t i = 0;
+    for (; i + group <= Count; i += group, dst += words * sizeof(uint64_t)) { // NOLINT(build/unsigned)
+      uint64_t packed[words] = {};                                           // NOLINT(build/unsigned)
+      detail::pack_group<Bits>(adcs + i, packed, std::make_index_sequence<group>{});
+      std::memcpy(dst, packed, sizeof(packed));
+    }
+
+    // Remainder, one value at a time
+    if constexpr (Count % group != 0) {
+      uint64_t acc = 0; // NOLINT(build/unsigned)
+      unsigned filled = 0;
+      for (; i < Count; ++i) {
+        const uint64_t adc = adcs[i] & ((1ULL << Bits) - 1); // NOLINT(build/unsigned)
+        acc |= adc << filled;
+        filled += Bits;
+        if (filled >= 64) {
+          std::memcpy(dst, &acc, sizeof(acc));
+          dst += sizeof(acc);
+          filled -= 64;
+          acc = filled ? adc >> (Bits - filled) : 0;
+        }
+      }
+      std::memcpy(dst, &acc, (filled + 7) / 8);
+    }
+  }
+}
+
+//! Primary template: no generator for this readout type
+template<class ReadoutType>
+struct FrameGeneratorTraits
+{
+  static constexpr bool available = false;
+};
+
+/**
+ * @brief Traits of readout types made of FramesPerElement frames of FrameSize bytes,
+ * each holding SamplesPerFrame x Channels packed ADCs (sample-major) at AdcOffset
+ */
+template<std::size_t Channels,
+         std::size_t SamplesPerFrame,
+         std::size_t FramesPerElement,
+         std::size_t FrameSize,
+         std::size_t AdcOffset,
+         unsigned AdcBits>
+struct PackedAdcGeneratorTraits
+{
+  static constexpr bool available = true;
+  static constexpr std::size_t num_channels = Channels;
+  static constexpr std::size_t samples_per_element = SamplesPerFrame * FramesPerElement;
+  static constexpr unsigned adc_bits = AdcBits;
+
+  //! Pack samples_per_element x num_channels ADCs (sample-major) into the element
+  template<class ReadoutType>
+  static void pack(const uint16_t* adcs, ReadoutType& element) // NOLINT(build/unsigned)
+  {
+    auto* bytes = reinterpret_cast<uint8_t*>(&element); // NOLINT(build/unsigned)
+    for (std::size_t frame = 0; frame < FramesPerElement; ++frame) {
+      pack_adcs<AdcBits, SamplesPerFrame * Channels>(adcs + frame * SamplesPerFrame * Channels,
+                                                     bytes + frame * FrameSize + AdcOffset);
+    }
+  }
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_FRAMEGENERATORTRAITS_HPP_
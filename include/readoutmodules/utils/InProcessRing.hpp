@@ -0,0 +1,187 @@
+/**
+ * @file InProcessRing.hpp Transport of raw elements between a fake card
+ * link and its DataLinkHandler in the same process. Elements are produced in
+ * place into ring slots, or handed over as descriptors into the read-only
+ * source buffer of the fake card, so that the only copy of the data is the
+ * one made by the consumer into its latency buffer.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_INPROCESSRING_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_INPROCESSRING_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/utils/SpscRing.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+/**
+ * @brief One ring slot: either an element written in place, or a descriptor
+ * of an element of the source buffer whose timestamps are still to be faked
+ *
+ * Slots are left uninitialized, a slot only occupies memory once an element
+ * is written into it.
+ */
+template<class ReadoutType>
+struct RawSlot
+{
+  const ReadoutType* data;  // &element, or an element of the source buffer
+  uint64_t first_timestamp; // NOLINT(build/unsigned)
+  uint64_t tick_diff;       // NOLINT(build/unsigned)
+  bool is_descriptor;       // first_timestamp and tick_diff are still to be applied to data
+  ReadoutType element;
+};
+
+//! Slots of a ring holding ring_capacity elements that travel in batches of batch_size
+inline std::size_t
+ring_slots(std::size_t ring_capacity, std::size_t batch_size)
+{
+  return std::max<std::size_t>(ring_capacity / std::max<std::size_t>(batch_size, 1), 16);
+}
+
+class InProcessRingBase
+{
+public:
+  virtual ~InProcessRingBase() {}
+  virtual std::size_t capacity() const = 0;
+};
+
+template<class ReadoutType>
+class InProcessRing : public InProcessRingBase
+{
+public:
+  using slot_t = RawSlot<ReadoutType>;
+
+  explicit InProcessRing(std::size_t capacity)
+    : m_ring(capacity)
+  {}
+
+  std::size_t capacity() const override { return m_ring.capacity(); }
+  std::size_t occupancy() const { return m_ring.occupancy(); }
+
+  //! Keep the memory descriptors point into alive as long as the ring; called at configuration
+  void keep_alive(std::shared_ptr<const void> owner)
+  {
+    std::lock_guard<std::mutex> lk(m_owners_mutex);
+    m_owners.push_back(std::move(owner));
+  }
+
+  //! Zero the elements of all slots, for producers that only write part of them; only while neither side is running
+  void zero_elements()
+  {
+    m_ring.for_each_slot([](slot_t& slot) { std::memset(static_cast<void*>(&slot.element), 0, sizeof(ReadoutType)); });
+  }
+
+  // Producer side
+  slot_t* write_slot() { return m_ring.write_slot(); }
+  void commit() { m_ring.commit(); }
+
+  // Consumer side
+  slot_t* read_slot() { return m_ring.read_slot(); }
+  void release() { m_ring.release(); }
+
+  //! Copy the element of a slot into dst, faking the timestamps of a descriptor
+  static void materialize(const slot_t& slot, ReadoutType& dst)
+  {
+    std::memcpy(static_cast<void*>(&dst), slot.data, sizeof(ReadoutType));
+    if (slot.is_descriptor) {
+      dst.fake_timestamps(slot.first_timestamp, slot.tick_diff);
+    }
+  }
+
+  //! Consumer: copy the oldest element into dst and release its slot; false if the ring is empty
+  bool pop_into(ReadoutType& dst)
+  {
+    const slot_t* slot = m_ring.read_slot();
+    if (slot == nullptr) {
+      return false;
+    }
+    materialize(*slot, dst);
+    m_ring.release();
+    return true;
+  }
+
+private:
+  SpscRing<slot_t> m_ring;
+  std::mutex m_owners_mutex;
+  std::vector<std::shared_ptr<const void>> m_owners;
+};
+
+/**
+ * @brief Process-wide lookup of the rings by connection uid
+ *
+ * The fake card and the DataLinkHandler acquire the ring of the raw data
+ * connection between them, whichever comes first creates it. The ring is
+ * destroyed, and its entry erased, once both sides released it.
+ */
+class InProcessRingRegistry
+{
+public:
+  static InProcessRingRegistry& get()
+  {
+    static InProcessRingRegistry registry;
+    return registry;
+  }
+
+  template<class ReadoutType>
+  std::shared_ptr<InProcessRing<ReadoutType>> acquire(const std::string& uid, std::size_t capacity)
+  {
+    // Checked once the lock is released: if the peer released the ring meanwhile, this reference is the last
+    // one, and dropping it erases the entry under the lock
+    std::shared_ptr<InProcessRingBase> existing;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      existing = m_rings[uid].lock();
+      if (existing == nullptr) {
+        std::shared_ptr<InProcessRing<ReadoutType>> ring(new InProcessRing<ReadoutType>(capacity),
+                                                         [this, uid](InProcessRing<ReadoutType>* released) {
+                                                           erase_expired(uid);
+                                                           delete released;
+                                                         });
+        m_rings[uid] = ring;
+        return ring;
+      }
+    }
+    auto ring = std::dynamic_pointer_cast<InProcessRing<ReadoutType>>(existing);
+    if (ring == nullptr) {
+      throw GenericConfigurationError(ERS_HERE, "The two ends of the in-process ring " + uid + " disagree on the data type");
+    }
+    if (ring->capacity() != SpscRing<RawSlot<ReadoutType>>::rounded_capacity(capacity)) {
+      throw GenericConfigurationError(ERS_HERE, "The two ends of the in-process ring " + uid + " disagree on its capacity");
+    }
+    return ring;
+  }
+
+private:
+  InProcessRingRegistry() = default;
+
+  // Called as the last user releases the ring of uid; a new ring may have taken its place meanwhile
+  void erase_expired(const std::string& uid)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto entry = m_rings.find(uid);
+    if (entry != m_rings.end() && entry->second.expired()) {
+      m_rings.erase(entry);
+    }
+  }
+
+  std::mutex m_mutex;
+  std::map<std::string, std::weak_ptr<InProcessRingBase>> m_rings;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_INPROCESSRING_HPP_
@@ -0,0 +1,231 @@
+/**
+ * @file IoUring.hpp Minimal io_uring submission and completion rings for
+ * asynchronous file writes, set up through the raw system calls so that
+ * there is no liburing dependency.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_IOURING_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_IOURING_HPP_
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#include <linux/io_uring.h>
+#define READOUTMODULES_HAVE_IO_URING 1
+#else
+#define READOUTMODULES_HAVE_IO_URING 0
+#endif
+
+namespace dunedaq {
+namespace readoutmodules {
+
+/**
+ * @brief One io_uring instance, driven by a single thread
+ *
+ * valid() is false when the kernel or its seccomp profile does not allow
+ * io_uring; callers fall back to synchronous writes.
+ */
+class IoUring
+{
+public:
+  explicit IoUring(unsigned entries) // NOLINT(build/unsigned)
+  {
+#if READOUTMODULES_HAVE_IO_URING
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (m_fd < 0) {
+      m_error = errno;
+      return;
+    }
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t); // NOLINT(build/unsigned)
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    m_sq_ptr = ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    m_cq_ptr = ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(
+      ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+    if (m_sq_ptr == MAP_FAILED || m_cq_ptr == MAP_FAILED || m_sqes == MAP_FAILED) {
+      m_error = errno;
+      release();
+      return;
+    }
+    auto* sq = static_cast<char*>(m_sq_ptr);
+    auto* cq = static_cast<char*>(m_cq_ptr);
+    m_sq_head = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);     // NOLINT(build/unsigned)
+    m_sq_tail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);     // NOLINT(build/unsigned)
+    m_sq_mask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask); // NOLINT(build/unsigned)
+    m_sq_array = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);   // NOLINT(build/unsigned)
+    m_sq_entries = params.sq_entries;
+    m_cq_head = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);     // NOLINT(build/unsigned)
+    m_cq_tail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);     // NOLINT(build/unsigned)
+    m_cq_mask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask); // NOLINT(build/unsigned)
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+#else
+    (void)entries;
+    m_error = ENOSYS;
+#endif
+  }
+
+  ~IoUring() { release(); }
+
+  IoUring(const IoUring&) = delete;            ///< IoUring is not copy-constructible
+  IoUring& operator=(const IoUring&) = delete; ///< IoUring is not copy-assignable
+  IoUring(IoUring&&) = delete;                 ///< IoUring is not move-constructible
+  IoUring& operator=(IoUring&&) = delete;      ///< IoUring is not move-assignable
+
+  bool valid() const { return m_fd >= 0; }
+  //! errno of the failed setup
+  int error() const { return m_error; }
+
+  /**
+   * @brief Queue a write of len bytes of buf at offset of fd and submit it
+   * @return true if the kernel took the write, whose completion then comes exactly once; false if the
+   * submission ring is full or the kernel refused it, in which case nothing was left queued
+   */
+  bool write(int fd, const void* buf, unsigned len, uint64_t offset, uint64_t user_data) // NOLINT(build/unsigned)
+  {
+#if READOUTMODULES_HAVE_IO_URING
+    const uint32_t tail = *m_sq_tail;                                                 // NOLINT(build/unsigned)
+    const uint32_t head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);                // NOLINT(build/unsigned)
+    if (tail - head == m_sq_entries) {
+      return false;
+    }
+    const uint32_t index = tail & m_sq_mask; // NOLINT(build/unsigned)
+    io_uring_sqe& sqe = m_sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(buf); // NOLINT(build/unsigned)
+    sqe.len = len;
+    sqe.off = offset;
+    sqe.user_data = user_data;
+    m_sq_array[index] = index;
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    int submitted = 0;
+    do {
+      submitted = take_injected_failure() ? -1 : enter(1, 0, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted == 1 || __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) != tail) {
+      return true;
+    }
+    // Without SQPOLL the kernel only reads the ring within io_uring_enter, so the entry it did not take
+    // (EAGAIN, EBUSY) can be withdrawn; left there, it would go out with the next submission
+    __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+    return false;
+#else
+    (void)fd, (void)buf, (void)len, (void)offset, (void)user_data;
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Take the oldest completion
+   * @param wait Block until one is available
+   * @return false if there is none (or the wait was interrupted)
+   */
+  bool complete(uint64_t& user_data, int& result, bool wait) // NOLINT(build/unsigned)
+  {
+#if READOUTMODULES_HAVE_IO_URING
+    uint32_t head = *m_cq_head;                                                   // NOLINT(build/unsigned)
+    if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+      if (!wait || enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+        return false;
+      }
+      if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+        return false;
+      }
+    }
+    const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+    user_data = cqe.user_data;
+    result = cqe.res;
+    __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+#else
+    (void)user_data, (void)result, (void)wait;
+    return false;
+#endif
+  }
+
+  //! Makes the next count submissions fail with EBUSY, as a busy kernel would, to test the callers
+  static void inject_submit_failures(unsigned count) { s_injected_failures = count; } // NOLINT(build/unsigned)
+
+private:
+  static bool take_injected_failure()
+  {
+    unsigned count = s_injected_failures.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    while (count > 0 && !s_injected_failures.compare_exchange_weak(count, count - 1, std::memory_order_relaxed)) {
+    }
+    if (count == 0) {
+      return false;
+    }
+    errno = EBUSY;
+    return true;
+  }
+
+#if READOUTMODULES_HAVE_IO_URING
+  int enter(unsigned to_submit, unsigned min_complete, unsigned flags) // NOLINT(build/unsigned)
+  {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+  }
+#endif
+
+  void release()
+  {
+#if READOUTMODULES_HAVE_IO_URING
+    if (m_sqes != nullptr && m_sqes != MAP_FAILED) {
+      ::munmap(m_sqes, m_sqes_size);
+    }
+    if (m_cq_ptr != nullptr && m_cq_ptr != MAP_FAILED) {
+      ::munmap(m_cq_ptr, m_cq_size);
+    }
+    if (m_sq_ptr != nullptr && m_sq_ptr != MAP_FAILED) {
+      ::munmap(m_sq_ptr, m_sq_size);
+    }
+    m_sqes = nullptr;
+    m_cq_ptr = nullptr;
+    m_sq_ptr = nullptr;
+#endif
+    if (m_fd >= 0) {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+  inline static std::atomic<unsigned> s_injected_failures{ 0 }; // NOLINT(build/unsigned)
+
+  int m_fd = -1;
+  int m_error = 0;
+#if READOUTMODULES_HAVE_IO_URING
+  void* m_sq_ptr = nullptr;
+  void* m_cq_ptr = nullptr;
+  io_uring_sqe* m_sqes = nullptr;
+  std::size_t m_sq_size = 0;
+  std::size_t m_cq_size = 0;
+  std::size_t m_sqes_size = 0;
+  uint32_t* m_sq_head = nullptr;  // NOLINT(build/unsigned)
+  uint32_t* m_sq_tail = nullptr;  // NOLINT(build/unsigned)
+  uint32_t* m_sq_array = nullptr; // NOLINT(build/unsigned)
+  uint32_t m_sq_mask = 0;         // NOLINT(build/unsigned)
+  uint32_t m_sq_entries = 0;      // NOLINT(build/unsigned)
+  uint32_t* m_cq_head = nullptr;  // NOLINT(build/unsigned)
+  uint32_t* m_cq_tail = nullptr;  // NOLINT(build/unsigned)
+  uint32_t m_cq_mask = 0;         // NOLINT(build/unsigned)
+  io_uring_cqe* m_cqes = nullptr;
+#endif
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_IOURING_HPP_
@@ -0,0 +1,133 @@
+/**
+ * @file LatencyHistogram.hpp Lock-free latency histogram with HDR-style
+ * log-linear buckets: every power of two is split in s_sub_buckets linear
+ * buckets, so that the relative error stays below 1/s_sub_buckets over the
+ * whole range. Durations are recorded in TSC ticks and converted to ns when
+ * summarized.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LATENCYHISTOGRAM_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LATENCYHISTOGRAM_HPP_
+
+#include "readoutmodules/utils/TscClock.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class LatencyHistogram
+{
+public:
+  //! Percentiles in ns of the durations recorded since the previous summary
+  struct Summary
+  {
+    uint64_t count = 0; // NOLINT(build/unsigned)
+    double p50_ns = 0.;
+    double p90_ns = 0.;
+    double p99_ns = 0.;
+    double p999_ns = 0.;
+    double max_ns = 0.;
+  };
+
+  LatencyHistogram() = default;
+
+  LatencyHistogram(const LatencyHistogram&) = delete;            ///< LatencyHistogram is not copy-constructible
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete; ///< LatencyHistogram is not copy-assignable
+  LatencyHistogram(LatencyHistogram&&) = delete;                 ///< LatencyHistogram is not move-constructible
+  LatencyHistogram& operator=(LatencyHistogram&&) = delete;      ///< LatencyHistogram is not move-assignable
+
+  //! Record a duration in TSC ticks; safe from any number of threads
+  void record(uint64_t ticks) // NOLINT(build/unsigned)
+  {
+    m_buckets[bucket_index(ticks)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    while (ticks > max && !m_max.compare_exchange_weak(max, ticks, std::memory_order_relaxed)) {
+    }
+  }
+
+  //! Summarize the recorded durations and start a new interval
+  Summary take()
+  {
+    std::array<uint64_t, s_num_buckets> counts; // NOLINT(build/unsigned)
+    Summary summary;
+    for (std::size_t i = 0; i < s_num_buckets; ++i) {
+      counts[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+      summary.count += counts[i];
+    }
+    summary.max_ns = TscClock::to_ns(m_max.exchange(0, std::memory_order_relaxed));
+    if (summary.count == 0) {
+      return summary;
+    }
+
+    const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+    double* results[] = { &summary.p50_ns, &summary.p90_ns, &summary.p99_ns, &summary.p999_ns };
+    uint64_t seen = 0; // NOLINT(build/unsigned)
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < s_num_buckets && next < 4; ++i) {
+      seen += counts[i];
+      while (next < 4 && seen > fractions[next] * (summary.count - 1)) {
+        *results[next++] = std::min(TscClock::to_ns(bucket_middle(i)), summary.max_ns);
+      }
+    }
+    return summary;
+  }
+
+private:
+  static constexpr unsigned s_sub_bucket_bits = 5;
+  static constexpr uint64_t s_sub_buckets = 1ULL << s_sub_bucket_bits; // NOLINT(build/unsigned)
+  static constexpr std::size_t s_num_buckets = (64 - s_sub_bucket_bits + 1) * s_sub_buckets;
+
+  static std::size_t bucket_index(uint64_t value) // NOLINT(build/unsigned)
+  {
+    if (value < s_sub_buckets) {
+      return value;
+    }
+    const unsigned shift = 63 - __builtin_clzll(value) - s_sub_bucket_bits;
+    return ((shift + 1) << s_sub_bucket_bits) + ((value >> shift) & (s_sub_buckets - 1));
+  }
+
+  static uint64_t bucket_middle(std::size_t index) // NOLINT(build/unsigned)
+  {
+    if (index < s_sub_buckets) {
+      return index;
+    }
+    const unsigned shift = (index >> s_sub_bucket_bits) - 1;
+    const uint64_t lower = (s_sub_buckets + (index & (s_sub_buckets - 1))) << shift; // NOLINT(build/unsigned)
+    return lower + ((1ULL << shift) >> 1);
+  }
+
+  std::array<std::atomic<uint64_t>, s_num_buckets> m_buckets{}; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max{ 0 };                            // NOLINT(build/unsigned)
+};
+
+//! Records the lifetime of the scope into a histogram
+class LatencyTimer
+{
+public:
+  explicit LatencyTimer(LatencyHistogram& histogram)
+    : m_histogram(histogram)
+    , m_start(TscClock::now())
+  {}
+  ~LatencyTimer() { m_histogram.record(TscClock::now() - m_start); }
+
+  LatencyTimer(const LatencyTimer&) = delete;            ///< LatencyTimer is not copy-constructible
+  LatencyTimer& operator=(const LatencyTimer&) = delete; ///< LatencyTimer is not copy-assignable
+  LatencyTimer(LatencyTimer&&) = delete;                 ///< LatencyTimer is not move-constructible
+  LatencyTimer& operator=(LatencyTimer&&) = delete;      ///< LatencyTimer is not move-assignable
+
+private:
+  LatencyHistogram& m_histogram;
+  uint64_t m_start; // NOLINT(build/unsigned)
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LATENCYHISTOGRAM_HPP_
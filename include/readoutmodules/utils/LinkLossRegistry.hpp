@@ -0,0 +1,66 @@
+/**
+ * @file LinkLossRegistry.hpp Process-wide lookup of the loss counters of the
+ * data link handlers by raw input connection uid, so that a fake card in the
+ * same process can tell whether the data it sends is kept.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LINKLOSSREGISTRY_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LINKLOSSREGISTRY_HPP_
+
+#include "readoutmodules/concepts/LossReportingReadoutConcept.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class LinkLossRegistry
+{
+public:
+  static LinkLossRegistry& get()
+  {
+    static LinkLossRegistry registry;
+    return registry;
+  }
+
+  //! Publish the counters of the readout reading uid; it must stay alive until withdraw(uid) returned
+  void publish(const std::string& uid, const LossReportingReadoutConcept* readout)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_readouts[uid] = readout;
+  }
+
+  void withdraw(const std::string& uid)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_readouts.erase(uid);
+  }
+
+  //! The counters of the readout reading uid, false if none is published in this process
+  bool get_loss_counters(const std::string& uid, ReadoutLossCounters& counters) const
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto readout = m_readouts.find(uid);
+    if (readout == m_readouts.end()) {
+      return false;
+    }
+    counters = readout->second->get_loss_counters();
+    return true;
+  }
+
+private:
+  LinkLossRegistry() = default;
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, const LossReportingReadoutConcept*> m_readouts;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LINKLOSSREGISTRY_HPP_
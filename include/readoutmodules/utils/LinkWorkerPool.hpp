@@ -0,0 +1,217 @@
+/**
+ * @file LinkWorkerPool.hpp A few worker threads that keep polling the work
+ * of many links, instead of a set of threads per link. Each link is polled by
+ * at most one worker at a time, so single-consumer inputs stay safe. Workers
+ * poll the links assigned to them and, when those have nothing to do or are
+ * held by another worker, steal polls of the other links.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LINKWORKERPOOL_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LINKWORKERPOOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+//! Cumulative counters of a LinkWorkerPool, since start()
+struct LinkWorkerPoolStats
+{
+  uint64_t polls = 0;       // NOLINT(build/unsigned) Link polls
+  uint64_t busy_polls = 0;  // NOLINT(build/unsigned) Polls that found work
+  uint64_t work_items = 0;  // NOLINT(build/unsigned) Units of work done by the polls
+  uint64_t steals = 0;      // NOLINT(build/unsigned) Busy polls of a link assigned to another worker
+  uint64_t idle_sleeps = 0; // NOLINT(build/unsigned) Sleeps after sweeps of all links without work
+};
+
+class LinkWorkerPool
+{
+public:
+  //! Do some of the pending work of a link and return how much, 0 if there was none
+  using poll_t = std::function<std::size_t()>;
+
+  LinkWorkerPool() {}
+  ~LinkWorkerPool() { stop(); }
+
+  LinkWorkerPool(const LinkWorkerPool&) = delete;            ///< LinkWorkerPool is not copy-constructible
+  LinkWorkerPool& operator=(const LinkWorkerPool&) = delete; ///< LinkWorkerPool is not copy-assignable
+  LinkWorkerPool(LinkWorkerPool&&) = delete;                 ///< LinkWorkerPool is not move-constructible
+  LinkWorkerPool& operator=(LinkWorkerPool&&) = delete;      ///< LinkWorkerPool is not move-assignable
+
+  /**
+   * @brief Start polling the links on up to one worker thread per link
+   * @param idle_sleep Sleep of a worker after idle_spins sweeps of all links found no work
+   */
+  void start(std::vector<poll_t> polls,
+             std::size_t workers,
+             std::chrono::microseconds idle_sleep,
+             std::size_t idle_spins,
+             const std::string& thread_name)
+  {
+    std::lock_guard<std::mutex> lk(m_workers_mutex);
+    stop_workers();
+    m_workers.clear();
+    m_links.clear();
+    for (auto& poll : polls) {
+      m_links.emplace_back(std::make_unique<Link>(std::move(poll)));
+    }
+    m_idle_sleep = idle_sleep;
+    m_idle_spins = idle_spins;
+    m_run = true;
+    const std::size_t num_workers = std::max<std::size_t>(1, std::min(workers, m_links.size()));
+    for (std::size_t w = 0; w < num_workers; ++w) {
+      m_workers.emplace_back(std::make_unique<Worker>());
+    }
+    for (std::size_t w = 0; w < num_workers; ++w) {
+      m_workers[w]->thread = std::thread(&LinkWorkerPool::run, this, w);
+      auto name = (thread_name + "-" + std::to_string(w)).substr(0, 15);
+      pthread_setname_np(m_workers[w]->thread.native_handle(), name.c_str());
+    }
+  }
+
+  //! Stop and join the workers; no poll is running once this returns
+  void stop()
+  {
+    std::lock_guard<std::mutex> lk(m_workers_mutex);
+    stop_workers();
+  }
+
+  std::size_t get_num_workers() const
+  {
+    std::lock_guard<std::mutex> lk(m_workers_mutex);
+    return m_workers.size();
+  }
+
+  //! Safe to call from another thread at any time, also while start() replaces the workers
+  LinkWorkerPoolStats get_stats() const
+  {
+    std::lock_guard<std::mutex> lk(m_workers_mutex);
+    LinkWorkerPoolStats stats;
+    for (const auto& worker : m_workers) {
+      stats.polls += worker->polls.load(std::memory_order_relaxed);
+      stats.busy_polls += worker->busy_polls.load(std::memory_order_relaxed);
+      stats.work_items += worker->work_items.load(std::memory_order_relaxed);
+      stats.steals += worker->steals.load(std::memory_order_relaxed);
+      stats.idle_sleeps += worker->idle_sleeps.load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+private:
+  // Called with m_workers_mutex held
+  void stop_workers()
+  {
+    m_run = false;
+    for (auto& worker : m_workers) {
+      if (worker->thread.joinable()) {
+        worker->thread.join();
+      }
+    }
+  }
+
+  struct alignas(64) Link
+  {
+    explicit Link(poll_t p)
+      : poll(std::move(p))
+    {}
+    poll_t poll;
+    std::atomic<bool> held{ false };
+  };
+
+  // Counters are only written by their worker
+  struct alignas(64) Worker
+  {
+    std::thread thread;
+    std::atomic<uint64_t> polls{ 0 };       // NOLINT(build/unsigned)
+    std::atomic<uint64_t> busy_polls{ 0 };  // NOLINT(build/unsigned)
+    std::atomic<uint64_t> work_items{ 0 };  // NOLINT(build/unsigned)
+    std::atomic<uint64_t> steals{ 0 };      // NOLINT(build/unsigned)
+    std::atomic<uint64_t> idle_sleeps{ 0 }; // NOLINT(build/unsigned)
+  };
+
+  static void increment(std::atomic<uint64_t>& counter, uint64_t n = 1) // NOLINT(build/unsigned)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  // Poll link i unless another worker holds it
+  std::size_t try_poll(Worker& worker, std::size_t i)
+  {
+    Link& link = *m_links[i];
+    if (link.held.load(std::memory_order_relaxed) || link.held.exchange(true, std::memory_order_acquire)) {
+      return 0;
+    }
+    std::size_t work = link.poll();
+    link.held.store(false, std::memory_order_release);
+    increment(worker.polls);
+    if (work > 0) {
+      increment(worker.busy_polls);
+      increment(worker.work_items, work);
+    }
+    return work;
+  }
+
+  void run(std::size_t w)
+  {
+    Worker& worker = *m_workers[w];
+    const std::size_t num_links = m_links.size();
+    const std::size_t num_workers = m_workers.size();
+    std::size_t victim = w;
+    std::size_t idle = 0;
+    while (m_run.load(std::memory_order_relaxed)) {
+      std::size_t work = 0;
+      for (std::size_t i = w; i < num_links; i += num_workers) {
+        work += try_poll(worker, i);
+      }
+      if (work == 0) {
+        // Steal one sweep of the others' links, starting from a different one each time
+        victim = (victim + 1) % num_links;
+        for (std::size_t k = 0; k < num_links; ++k) {
+          const std::size_t i = (victim + k) % num_links;
+          if (i % num_workers != w) {
+            const std::size_t stolen = try_poll(worker, i);
+            if (stolen > 0) {
+              increment(worker.steals);
+              work += stolen;
+            }
+          }
+        }
+      }
+      if (work > 0) {
+        idle = 0;
+      } else if (++idle < m_idle_spins) {
+        std::this_thread::yield();
+      } else {
+        increment(worker.idle_sleeps);
+        std::this_thread::sleep_for(m_idle_sleep);
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Link>> m_links;
+  // The workers only read m_links and m_workers, which change in start() once they are joined
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  mutable std::mutex m_workers_mutex;
+  std::atomic<bool> m_run{ false };
+  std::chrono::microseconds m_idle_sleep{ 100 };
+  std::size_t m_idle_spins = 64;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_LINKWORKERPOOL_HPP_
@@ -0,0 +1,163 @@
+/**
+ * @file MappedSourceBuffer.hpp Read-only, memory-mapped view of a raw
+ * binary source file. A single instance is owned by the FakeCardReaderBase
+ * for every distinct file and shared by reference among its emulators that
+ * implement SourceEmulatorLinkConcept; other emulators load their own copy.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MAPPEDSOURCEBUFFER_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MAPPEDSOURCEBUFFER_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class MappedSourceBuffer
+{
+public:
+  /**
+   * @brief Map (at most input_limit bytes of) a source file read-only
+   * @param filename Raw binary file to map
+   * @param input_limit Maximum number of bytes to expose
+   * @param use_hugepages Copy the file into a hugepage-backed anonymous region instead of mapping the page cache
+   */
+  MappedSourceBuffer(const std::string& filename, std::size_t input_limit, bool use_hugepages)
+    : m_filename(filename)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_mapped_size(0)
+    , m_hugepage_backed(false)
+  {
+    int fd = ::open(m_filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw CannotOpenFile(ERS_HERE, m_filename);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      int err = errno;
+      ::close(fd);
+      throw CannotMapFile(ERS_HERE, m_filename, std::strerror(err));
+    }
+    m_size = std::min(static_cast<std::size_t>(st.st_size), input_limit);
+
+    if (m_size > 0) {
+      try {
+        if (use_hugepages) {
+          load_into_hugepages(fd);
+        } else {
+          map_file(fd);
+        }
+      } catch (const ers::Issue&) {
+        if (m_data != nullptr) {
+          ::munmap(m_data, m_mapped_size);
+        }
+        ::close(fd);
+        throw;
+      }
+    }
+    ::close(fd);
+
+    TLOG() << "Source buffer for " << m_filename << " holds " << m_size << " bytes"
+           << (m_hugepage_backed ? " (hugepage backed)" : "");
+  }
+
+  ~MappedSourceBuffer()
+  {
+    if (m_data != nullptr) {
+      ::munmap(m_data, m_mapped_size);
+    }
+  }
+
+  MappedSourceBuffer(const MappedSourceBuffer&) = delete;            ///< MappedSourceBuffer is not copy-constructible
+  MappedSourceBuffer& operator=(const MappedSourceBuffer&) = delete; ///< MappedSourceBuffer is not copy-assignable
+  MappedSourceBuffer(MappedSourceBuffer&&) = delete;                 ///< MappedSourceBuffer is not move-constructible
+  MappedSourceBuffer& operator=(MappedSourceBuffer&&) = delete;      ///< MappedSourceBuffer is not move-assignable
+
+  const std::string& get_filename() const { return m_filename; }
+  const std::uint8_t* data() const { return static_cast<const std::uint8_t*>(m_data); }
+  std::size_t size() const { return m_size; }
+  std::size_t num_elements(std::size_t element_size) const { return m_size / element_size; }
+  bool is_hugepage_backed() const { return m_hugepage_backed; }
+
+private:
+  // Map the file straight from the page cache: every process reading it shares the same pages.
+  void map_file(int fd)
+  {
+    m_mapped_size = m_size;
+    m_data = ::mmap(nullptr, m_mapped_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (m_data == MAP_FAILED) {
+      m_data = nullptr;
+      throw CannotMapFile(ERS_HERE, m_filename, std::strerror(errno));
+    }
+    ::madvise(m_data, m_mapped_size, MADV_WILLNEED);
+  }
+
+  // Copy the file into an anonymous region backed by explicit hugepages if the
+  // system has them reserved, falling back to transparent hugepages otherwise.
+  void load_into_hugepages(int fd)
+  {
+    m_mapped_size = (m_size + s_hugepage_size - 1) & ~(s_hugepage_size - 1);
+    m_data = ::mmap(nullptr,
+                    m_mapped_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+                    -1,
+                    0);
+    if (m_data != MAP_FAILED) {
+      m_hugepage_backed = true;
+    } else {
+      TLOG() << "No hugepages reserved for " << m_filename << ", falling back to transparent hugepages";
+      m_data = ::mmap(nullptr, m_mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (m_data == MAP_FAILED) {
+        m_data = nullptr;
+        throw CannotMapFile(ERS_HERE, m_filename, std::strerror(errno));
+      }
+      m_hugepage_backed = (::madvise(m_data, m_mapped_size, MADV_HUGEPAGE) == 0);
+    }
+
+    auto* dst = static_cast<char*>(m_data);
+    std::size_t done = 0;
+    while (done < m_size) {
+      ssize_t bytes = ::pread(fd, dst + done, m_size - done, static_cast<off_t>(done));
+      if (bytes < 0 && errno == EINTR) {
+        continue;
+      }
+      if (bytes <= 0) {
+        throw CannotMapFile(ERS_HERE, m_filename, bytes == 0 ? "unexpected end of file" : std::strerror(errno));
+      }
+      done += static_cast<std::size_t>(bytes);
+    }
+    ::mprotect(m_data, m_mapped_size, PROT_READ);
+  }
+
+  static constexpr std::size_t s_hugepage_size = 2 * 1024 * 1024;
+
+  std::string m_filename;
+  void* m_data;
+  std::size_t m_size;
+  std::size_t m_mapped_size;
+  bool m_hugepage_backed;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MAPPEDSOURCEBUFFER_HPP_
@@ -0,0 +1,106 @@
+/**
+ * @file MemoryPrefault.hpp Fault in a large buffer ahead of a run, so that
+ * its first writes do not take page faults on the hot path. The pages can be
+ * placed on a NUMA node and backed by transparent hugepages first.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MEMORYPREFAULT_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MEMORYPREFAULT_HPP_
+
+#include "readoutmodules/utils/ParallelFor.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+//! What prefault_memory did
+struct PrefaultResult
+{
+  std::size_t bytes = 0;          ///< Bytes of whole pages touched
+  bool numa_bound = false;        ///< The pages were bound to the requested node
+  bool hugepages_advised = false; ///< The range was marked for transparent hugepages
+};
+
+namespace detail {
+
+// mbind(2) without a libnuma dependency; MPOL_PREFERRED and MPOL_MF_MOVE from linux/mempolicy.h
+inline bool
+bind_to_numa_node(void* addr, std::size_t len, int node)
+{
+  constexpr int mpol_preferred = 1;
+  constexpr unsigned mpol_mf_move = 1 << 1;
+  constexpr std::size_t mask_bits = 8 * sizeof(unsigned long); // NOLINT(runtime/int)
+  if (node < 0 || static_cast<std::size_t>(node) >= mask_bits) {
+    return false;
+  }
+  unsigned long mask = 1UL << node; // NOLINT(runtime/int)
+  return ::syscall(SYS_mbind, addr, len, mpol_preferred, &mask, mask_bits + 1, mpol_mf_move) == 0;
+}
+
+} // namespace detail
+
+/**
+ * @brief Touch every page of [data, data + size), on up to threads threads
+ * @param numa_node Node to place the pages on beforehand, -1 to leave them where they are
+ * @param hugepages Mark the range for transparent hugepages beforehand
+ *
+ * Pages are read and written back, the content of the buffer is preserved.
+ * Binding and hugepages are best effort: a failure is logged and the pages
+ * are touched anyway.
+ */
+inline PrefaultResult
+prefault_memory(void* data, std::size_t size, int numa_node, bool hugepages, std::size_t threads)
+{
+  PrefaultResult result;
+  const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const auto first = (reinterpret_cast<std::uintptr_t>(data) + page - 1) & ~(page - 1);
+  const auto last = (reinterpret_cast<std::uintptr_t>(data) + size) & ~(page - 1);
+  if (data == nullptr || last <= first) {
+    return result;
+  }
+  auto* begin = reinterpret_cast<char*>(first);
+  const std::size_t len = last - first;
+
+  if (hugepages) {
+    result.hugepages_advised = (::madvise(begin, len, MADV_HUGEPAGE) == 0);
+    if (!result.hugepages_advised) {
+      TLOG() << "Transparent hugepages not available for a " << len << " bytes buffer: " << std::strerror(errno);
+    }
+  }
+  if (numa_node >= 0) {
+    result.numa_bound = detail::bind_to_numa_node(begin, len, numa_node);
+    if (!result.numa_bound) {
+      TLOG() << "Could not bind a " << len << " bytes buffer to NUMA node " << numa_node << ": "
+             << std::strerror(errno);
+    }
+  }
+
+  // Chunks of whole hugepages, so that threads do not fault the same hugepage
+  constexpr std::size_t chunk = 64 * 1024 * 1024;
+  parallel_for((len + chunk - 1) / chunk, threads, [&](std::size_t c) {
+    volatile char* p = begin + c * chunk;
+    volatile char* end = begin + std::min(len, (c + 1) * chunk);
+    for (; p < end; p += page) {
+      *p = *p;
+    }
+  });
+  result.bytes = len;
+  return result;
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MEMORYPREFAULT_HPP_
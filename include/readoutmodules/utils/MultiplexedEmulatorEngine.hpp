@@ -0,0 +1,154 @@
+/**
+ * @file MultiplexedEmulatorEngine.hpp Drives many emulated links from a few
+ * (optionally pinned) threads. Every thread keeps the deadlines of its links
+ * in a min-heap and emits the element of the earliest one when it is due.
+ * Links never wait for their output: an element that finds it full is
+ * dropped and counted, so that one stalled consumer does not hold up the
+ * other links of the thread.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MULTIPLEXEDEMULATORENGINE_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MULTIPLEXEDEMULATORENGINE_HPP_
+
+#include "readoutmodules/concepts/SourceEmulatorLinkConcept.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <immintrin.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class MultiplexedEmulatorEngine
+{
+public:
+  explicit MultiplexedEmulatorEngine(std::atomic<bool>& run_marker)
+    : m_run_marker(run_marker)
+  {}
+
+  ~MultiplexedEmulatorEngine() { stop(); }
+
+  MultiplexedEmulatorEngine(const MultiplexedEmulatorEngine&) = delete; ///< Not copy-constructible
+  MultiplexedEmulatorEngine& operator=(const MultiplexedEmulatorEngine&) = delete; ///< Not copy-assignable
+  MultiplexedEmulatorEngine(MultiplexedEmulatorEngine&&) = delete;                 ///< Not move-constructible
+  MultiplexedEmulatorEngine& operator=(MultiplexedEmulatorEngine&&) = delete;      ///< Not move-assignable
+
+  /**
+   * @brief Distribute the links round robin over the engine threads
+   * @param links Links to drive, they are switched to engine-driven mode
+   * @param num_threads Number of engine threads, capped to the number of links: none without links
+   * @param cpus Cores the threads are pinned to, round robin; empty means no pinning
+   */
+  void conf(const std::vector<SourceEmulatorLinkConcept*>& links, std::size_t num_threads, const std::vector<int>& cpus)
+  {
+    m_workers.clear();
+    num_threads = links.empty() ? 0 : std::max<std::size_t>(1, std::min(num_threads, links.size()));
+    for (std::size_t i = 0; i < num_threads; ++i) {
+      m_workers.push_back(std::make_unique<Worker>());
+      m_workers.back()->cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+    }
+    for (std::size_t i = 0; i < links.size(); ++i) {
+      links[i]->set_engine_driven(true);
+      m_workers[i % num_threads]->links.push_back(links[i]);
+    }
+    TLOG() << "Emulator engine drives " << links.size() << " links from " << num_threads << " threads";
+  }
+
+  void start()
+  {
+    auto epoch = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < m_workers.size(); ++i) {
+      auto& worker = *m_workers[i];
+      worker.thread = std::thread(&MultiplexedEmulatorEngine::run_worker, this, std::ref(worker), epoch);
+      std::string name = "fakeengine-" + std::to_string(i);
+      pthread_setname_np(worker.thread.native_handle(), name.c_str());
+      if (worker.cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(worker.cpu, &cpuset);
+        if (pthread_setaffinity_np(worker.thread.native_handle(), sizeof(cpu_set_t), &cpuset) != 0) {
+          TLOG() << "Could not pin emulator engine thread " << i << " to CPU " << worker.cpu;
+        }
+      }
+    }
+  }
+
+  // Threads leave their loop once the run marker is cleared
+  void stop()
+  {
+    for (auto& worker : m_workers) {
+      if (worker->thread.joinable()) {
+        worker->thread.join();
+      }
+    }
+  }
+
+  void scrap()
+  {
+    stop();
+    m_workers.clear();
+  }
+
+private:
+  struct Worker
+  {
+    std::vector<SourceEmulatorLinkConcept*> links;
+    std::thread thread;
+    int cpu = -1;
+  };
+
+  // Deadlines are kept in ns from a common epoch as doubles, so that
+  // fractional periods do not accumulate a rate error.
+  using deadline_t = std::pair<double, std::size_t>;
+
+  void run_worker(Worker& worker, std::chrono::steady_clock::time_point epoch)
+  {
+    std::priority_queue<deadline_t, std::vector<deadline_t>, std::greater<deadline_t>> deadlines;
+    for (std::size_t i = 0; i < worker.links.size(); ++i) {
+      deadlines.emplace(0., i);
+    }
+
+    while (m_run_marker.load(std::memory_order_relaxed)) {
+      auto [deadline, index] = deadlines.top();
+      double now = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - epoch).count();
+      if (deadline > now) {
+        // Sleep through long gaps, spin through the last stretch to keep the rate accurate
+        if (deadline - now > s_spin_threshold_ns) {
+          std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<int64_t>(deadline - now - s_spin_threshold_ns)));
+        } else {
+          _mm_pause();
+        }
+        continue;
+      }
+      deadlines.pop();
+      deadlines.emplace(deadline + worker.links[index]->produce_next(), index);
+    }
+  }
+
+  static constexpr double s_spin_threshold_ns = 50000.;
+
+  std::atomic<bool>& m_run_marker;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_MULTIPLEXEDEMULATORENGINE_HPP_
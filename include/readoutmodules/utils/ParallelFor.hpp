@@ -0,0 +1,78 @@
+/**
+ * @file ParallelFor.hpp Run independent setup work items on a few
+ * short-lived threads, for transitions that would otherwise handle many
+ * links one after another.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_PARALLELFOR_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_PARALLELFOR_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+/**
+ * @brief Call work(i) for every i in [0, count) on at most max_threads threads
+ *
+ * Items are picked dynamically, so that slow items do not hold back a whole
+ * share. The calling thread takes part. The first exception thrown by an item
+ * is rethrown once all threads are done; the remaining items are skipped.
+ */
+template<class Work>
+void
+parallel_for(std::size_t count, std::size_t max_threads, Work&& work)
+{
+  const std::size_t num_threads = std::max<std::size_t>(1, std::min(count, max_threads));
+  std::atomic<std::size_t> next{ 0 };
+  std::atomic<bool> failed{ false };
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < count && !failed.load(); i = next++) {
+      try {
+        work(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lk(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < num_threads; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+//! Default number of setup threads: the hardware threads, at least one
+inline std::size_t
+default_setup_threads()
+{
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_PARALLELFOR_HPP_
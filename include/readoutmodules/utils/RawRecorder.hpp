@@ -0,0 +1,689 @@
+/**
+ * @file RawRecorder.hpp Records the raw elements of a link to disk without
+ * ever making the readout thread wait. Elements are copied into large aligned
+ * blocks; full blocks are written with O_DIRECT, either asynchronously through
+ * io_uring or by a few writer threads, optionally compressed first. Written
+ * blocks are handed back to the producer through a free flag per block, so it
+ * never takes a lock to find one; when every block is still being written the
+ * element is dropped and counted.
+ *
+ * Uncompressed recordings are the plain concatenation of the elements, as the
+ * readoutlibs recordings, and can be replayed by the fake card. Compressed
+ * recordings are a sequence of frames, each a RecordedFrameHeader followed by
+ * the compressed block and zero padding up to frame_size bytes; frames can
+ * appear out of sequence order when several writer threads are used.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_RAWRECORDER_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_RAWRECORDER_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/utils/IoUring.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<lz4.h>)
+#include <lz4.h>
+#define READOUTMODULES_HAVE_LZ4 1
+#else
+#define READOUTMODULES_HAVE_LZ4 0
+#endif
+
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define READOUTMODULES_HAVE_ZSTD 1
+#else
+#define READOUTMODULES_HAVE_ZSTD 0
+#endif
+
+namespace dunedaq {
+namespace readoutmodules {
+
+enum class RecorderEngine
+{
+  io_uring, ///< One thread keeping up to all blocks in flight through io_uring
+  threads   ///< Writer threads, each with one synchronous write in flight
+};
+
+enum class RecorderCompression
+{
+  none,
+  lz4,
+  zstd ///< zstd level 1
+};
+
+struct RawRecorderConf
+{
+  std::string filename;
+  std::size_t block_size = 8 * 1024 * 1024; ///< Multiple of 4 kB
+  std::size_t blocks = 8;                   ///< Bound of the memory, and of the data in flight; at least 2
+  RecorderEngine engine = RecorderEngine::io_uring;
+  RecorderCompression compression = RecorderCompression::none;
+  std::size_t threads = 2; ///< Writer threads of the threads engine
+  bool direct_io = true;   ///< Open with O_DIRECT, falling back to buffered writes where it is refused
+};
+
+//! Cumulative counters of a RawRecorder, since open()
+struct RawRecorderStats
+{
+  uint64_t recorded_bytes = 0;  // NOLINT(build/unsigned)
+  uint64_t written_bytes = 0;   // NOLINT(build/unsigned)
+  uint64_t dropped_records = 0; // NOLINT(build/unsigned)
+  uint64_t dropped_bytes = 0;   // NOLINT(build/unsigned)
+  uint64_t blocks_written = 0;  // NOLINT(build/unsigned)
+  uint64_t write_errors = 0;    // NOLINT(build/unsigned)
+};
+
+//! Header of each frame of a compressed recording
+struct RecordedFrameHeader
+{
+  static constexpr uint32_t s_magic = 0x52524331; // NOLINT(build/unsigned) "RRC1"
+  uint32_t magic;                                 // NOLINT(build/unsigned)
+  uint32_t compression;                           // NOLINT(build/unsigned) RecorderCompression, none if stored as is
+  uint64_t sequence;                              // NOLINT(build/unsigned) Block number in recording order
+  uint64_t raw_size;                              // NOLINT(build/unsigned)
+  uint64_t compressed_size;                       // NOLINT(build/unsigned)
+  uint64_t frame_size;                            // NOLINT(build/unsigned) Header, data and padding
+};
+
+namespace detail {
+
+constexpr std::size_t s_direct_io_alignment = 4096;
+
+inline std::size_t
+align_up(std::size_t n)
+{
+  return (n + s_direct_io_alignment - 1) & ~(s_direct_io_alignment - 1);
+}
+
+inline bool
+compression_available(RecorderCompression compression)
+{
+  switch (compression) {
+    case RecorderCompression::lz4:
+      return READOUTMODULES_HAVE_LZ4;
+    case RecorderCompression::zstd:
+      return READOUTMODULES_HAVE_ZSTD;
+    default:
+      return true;
+  }
+}
+
+inline std::size_t
+compress_bound(RecorderCompression compression, std::size_t size)
+{
+#if READOUTMODULES_HAVE_LZ4
+  if (compression == RecorderCompression::lz4) {
+    return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(size)));
+  }
+#endif
+#if READOUTMODULES_HAVE_ZSTD
+  if (compression == RecorderCompression::zstd) {
+    return ZSTD_compressBound(size);
+  }
+#endif
+  (void)compression;
+  return size;
+}
+
+// Compressed size, 0 if the block could not be compressed
+inline std::size_t
+compress_block(RecorderCompression compression, const char* src, std::size_t size, char* dst, std::size_t capacity)
+{
+#if READOUTMODULES_HAVE_LZ4
+  if (compression == RecorderCompression::lz4) {
+    const int n = LZ4_compress_default(src, dst, static_cast<int>(size), static_cast<int>(capacity));
+    return n > 0 ? static_cast<std::size_t>(n) : 0;
+  }
+#endif
+#if READOUTMODULES_HAVE_ZSTD
+  if (compression == RecorderCompression::zstd) {
+    // One context per writer thread, contexts are expensive to create
+    thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+    const std::size_t n = ZSTD_compressCCtx(context.get(), dst, capacity, src, size, 1);
+    return ZSTD_isError(n) ? 0 : n;
+  }
+#endif
+  (void)compression, (void)src, (void)size, (void)dst, (void)capacity;
+  return 0;
+}
+
+} // namespace detail
+
+class RawRecorder
+{
+public:
+  RawRecorder() {}
+  ~RawRecorder() { close(); }
+
+  RawRecorder(const RawRecorder&) = delete;            ///< RawRecorder is not copy-constructible
+  RawRecorder& operator=(const RawRecorder&) = delete; ///< RawRecorder is not copy-assignable
+  RawRecorder(RawRecorder&&) = delete;                 ///< RawRecorder is not move-constructible
+  RawRecorder& operator=(RawRecorder&&) = delete;      ///< RawRecorder is not move-assignable
+
+  //! Create the file, allocate the blocks and start the writers; recording starts with start()
+  void open(const RawRecorderConf& conf)
+  {
+    close();
+    if (conf.block_size < 2 * detail::s_direct_io_alignment || conf.block_size % detail::s_direct_io_alignment != 0) {
+      throw GenericConfigurationError(ERS_HERE, "Recording blocks must be a multiple of 4096 bytes, at least 8192");
+    }
+    if (conf.blocks < 2) {
+      throw GenericConfigurationError(ERS_HERE, "Recording needs at least two blocks");
+    }
+    if (!detail::compression_available(conf.compression)) {
+      throw GenericConfigurationError(ERS_HERE, "readoutmodules was built without the requested recording compression");
+    }
+    m_conf = conf;
+
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    m_direct_io = false;
+    m_fd = -1;
+    if (conf.direct_io) {
+      m_fd = ::open(conf.filename.c_str(), flags | O_DIRECT, 0644);
+      m_direct_io = (m_fd >= 0);
+      if (m_fd < 0) {
+        TLOG() << "O_DIRECT refused for " << conf.filename << " (" << std::strerror(errno)
+               << "), recording through the page cache";
+      }
+    }
+    if (m_fd < 0) {
+      m_fd = ::open(conf.filename.c_str(), flags, 0644);
+    }
+    if (m_fd < 0) {
+      throw CannotOpenFile(ERS_HERE, conf.filename);
+    }
+
+    const std::size_t out_size = m_conf.compression == RecorderCompression::none
+                                   ? 0
+                                   : detail::align_up(sizeof(RecordedFrameHeader) +
+                                                      detail::compress_bound(m_conf.compression, m_conf.block_size));
+    m_blocks.resize(m_conf.blocks);
+    m_free.reset(new std::atomic<bool>[m_blocks.size()]);
+    for (std::size_t i = 0; i < m_blocks.size(); ++i) {
+      m_blocks[i].index = i;
+      m_blocks[i].data = allocate(m_conf.block_size);
+      m_blocks[i].out = out_size > 0 ? allocate(out_size) : nullptr;
+      m_blocks[i].out_size = out_size;
+      m_free[i].store(true, std::memory_order_relaxed);
+    }
+    m_next_free = 0;
+
+    m_engine = m_conf.engine;
+    if (m_engine == RecorderEngine::io_uring) {
+      m_uring = std::make_unique<IoUring>(static_cast<unsigned>(m_conf.blocks)); // NOLINT(build/unsigned)
+      if (!m_uring->valid()) {
+        TLOG() << "io_uring not available (" << std::strerror(m_uring->error())
+               << "), recording with writer threads";
+        m_uring.reset();
+        m_engine = RecorderEngine::threads;
+      }
+    }
+
+    m_file_size = 0;
+    m_sequence = 0;
+    m_carry_len = 0;
+    m_pending = false;
+    m_workers_run = true;
+    if (m_engine == RecorderEngine::io_uring) {
+      m_workers.emplace_back(&RawRecorder::run_io_uring, this);
+    } else {
+      for (std::size_t t = 0; t < std::max<std::size_t>(1, m_conf.threads); ++t) {
+        m_workers.emplace_back(&RawRecorder::run_threads, this);
+      }
+    }
+  }
+
+  //! Write out what was recorded and release everything; the producer must not call record() any more
+  void close()
+  {
+    if (m_fd < 0) {
+      return;
+    }
+    stop();
+    {
+      std::lock_guard<std::mutex> lk(m_filled_mutex);
+      m_workers_run = false;
+    }
+    m_filled_cv.notify_all();
+    for (auto& worker : m_workers) {
+      worker.join();
+    }
+    m_workers.clear();
+    m_uring.reset();
+
+    // The unaligned tail of an uncompressed recording goes through the page cache
+    if (m_carry_len > 0) {
+      if (m_direct_io) {
+        ::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+      }
+      if (write_all(m_carry, m_carry_len, m_file_size)) {
+        m_written_bytes += m_carry_len;
+      }
+      m_carry_len = 0;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+
+    for (auto& block : m_blocks) {
+      std::free(block.data);
+      std::free(block.out);
+    }
+    m_blocks.clear();
+    m_free.reset();
+    m_filled.clear();
+    m_current = nullptr;
+    m_next = nullptr;
+  }
+
+  //! Record the elements passed to record() for duration; may be called while the producer runs
+  void start(std::chrono::milliseconds duration)
+  {
+    if (m_fd < 0) {
+      return;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + duration;
+    m_deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    m_active.store(true, std::memory_order_release);
+  }
+
+  //! End the recording now and hand the partial block to the writers; the producer must not be running
+  void stop()
+  {
+    m_active.store(false, std::memory_order_release);
+    if (m_pending) {
+      flush();
+    }
+  }
+
+  bool is_active() const { return m_active.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Producer: append one element to the recording, if it is active
+   *
+   * Never blocks. The element is dropped only when it does not fit into the
+   * current block and every other block is still waiting to be written.
+   */
+  void record(const void* data, std::size_t size)
+  {
+    if (!m_active.load(std::memory_order_relaxed)) {
+      if (m_pending) {
+        flush();
+      }
+      return;
+    }
+    if (m_current == nullptr && !take_current()) {
+      drop(size);
+      return;
+    }
+    if (m_current->used + size > m_conf.block_size) {
+      if (size > m_conf.block_size - detail::s_direct_io_alignment) {
+        drop(size);
+        return;
+      }
+      if (m_next == nullptr) {
+        m_next = try_take_free();
+        if (m_next == nullptr) {
+          drop(size);
+          return;
+        }
+      }
+      hand_over(m_current);
+      m_current = m_next;
+      m_next = try_take_free();
+      start_block(m_current);
+    }
+    std::memcpy(m_current->data + m_current->used, data, size);
+    m_current->used += size;
+    m_recorded_bytes.store(m_recorded_bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+    m_pending = true;
+  }
+
+  RawRecorderStats get_stats() const
+  {
+    RawRecorderStats stats;
+    stats.recorded_bytes = m_recorded_bytes.load(std::memory_order_relaxed);
+    stats.written_bytes = m_written_bytes.load(std::memory_order_relaxed);
+    stats.dropped_records = m_dropped_records.load(std::memory_order_relaxed);
+    stats.dropped_bytes = m_dropped_bytes.load(std::memory_order_relaxed);
+    stats.blocks_written = m_blocks_written.load(std::memory_order_relaxed);
+    stats.write_errors = m_write_errors.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  //! The engine in use, after a possible fallback from io_uring
+  RecorderEngine get_engine() const { return m_engine; }
+  bool is_direct_io() const { return m_direct_io; }
+
+private:
+  struct Block
+  {
+    std::size_t index = 0;
+    char* data = nullptr;
+    std::size_t used = 0;
+    char* out = nullptr; // Frame buffer, when compressing
+    std::size_t out_size = 0;
+    uint64_t sequence = 0; // NOLINT(build/unsigned)
+    // The write in progress
+    const char* write_ptr = nullptr;
+    std::size_t write_len = 0;
+    std::size_t written = 0;
+    uint64_t offset = 0; // NOLINT(build/unsigned)
+  };
+
+  static char* allocate(std::size_t size)
+  {
+    void* ptr = nullptr;
+    if (::posix_memalign(&ptr, detail::s_direct_io_alignment, size) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<char*>(ptr);
+  }
+
+  // Producer side
+
+  void drop(std::size_t size)
+  {
+    m_dropped_records.store(m_dropped_records.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_dropped_bytes.store(m_dropped_bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+  }
+
+  // Only the producer clears the flags, so a block seen free is its own; nullptr if all are in use
+  Block* try_take_free()
+  {
+    for (std::size_t i = 0; i < m_blocks.size(); ++i) {
+      const std::size_t index = (m_next_free + i) % m_blocks.size();
+      if (m_free[index].load(std::memory_order_acquire)) {
+        m_free[index].store(false, std::memory_order_relaxed);
+        m_next_free = index + 1;
+        return &m_blocks[index];
+      }
+    }
+    return nullptr;
+  }
+
+  bool take_current()
+  {
+    m_current = m_next != nullptr ? m_next : try_take_free();
+    m_next = nullptr;
+    if (m_current == nullptr) {
+      return false;
+    }
+    start_block(m_current);
+    m_next = try_take_free();
+    return true;
+  }
+
+  // A new block starts with the bytes of the previous one that could not be written with O_DIRECT
+  void start_block(Block* block)
+  {
+    std::memcpy(block->data, m_carry, m_carry_len);
+    block->used = m_carry_len;
+    m_carry_len = 0;
+  }
+
+  void hand_over(Block* block)
+  {
+    if (block->used == 0) {
+      release(block);
+      return;
+    }
+    block->written = 0;
+    block->sequence = m_sequence++;
+    if (m_conf.compression == RecorderCompression::none) {
+      const std::size_t aligned = block->used & ~(detail::s_direct_io_alignment - 1);
+      m_carry_len = block->used - aligned;
+      std::memcpy(m_carry, block->data + aligned, m_carry_len);
+      block->write_ptr = block->data;
+      block->write_len = aligned;
+      block->offset = m_file_size.fetch_add(aligned);
+      if (aligned == 0) {
+        release(block);
+        return;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lk(m_filled_mutex);
+      m_filled.push_back(block);
+    }
+    m_filled_cv.notify_one();
+  }
+
+  void flush()
+  {
+    if (m_current != nullptr) {
+      hand_over(m_current);
+      m_current = nullptr;
+    }
+    m_pending = false;
+  }
+
+  // Writer side
+
+  // The release pairs with the acquire of try_take_free: the block is done with once the producer sees it free
+  void release(Block* block) { m_free[block->index].store(true, std::memory_order_release); }
+
+  void check_deadline()
+  {
+    if (m_active.load(std::memory_order_acquire)) {
+      const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+      if (now >= m_deadline_ns.load(std::memory_order_relaxed)) {
+        m_active.store(false, std::memory_order_release);
+      }
+    }
+  }
+
+  // Next filled block, waiting for one up to timeout; nullptr once closed and drained
+  Block* pop_filled(std::chrono::milliseconds timeout, bool& closed)
+  {
+    std::unique_lock<std::mutex> lk(m_filled_mutex);
+    if (m_filled.empty() && m_workers_run) {
+      m_filled_cv.wait_for(lk, timeout);
+    }
+    closed = m_filled.empty() && !m_workers_run;
+    if (m_filled.empty()) {
+      return nullptr;
+    }
+    Block* block = m_filled.front();
+    m_filled.pop_front();
+    return block;
+  }
+
+  // Compress the block into its frame buffer and reserve its place in the file
+  void prepare(Block* block)
+  {
+    if (m_conf.compression == RecorderCompression::none) {
+      return;
+    }
+    auto* header = reinterpret_cast<RecordedFrameHeader*>(block->out);
+    char* payload = block->out + sizeof(RecordedFrameHeader);
+    const std::size_t capacity = block->out_size - sizeof(RecordedFrameHeader);
+    std::size_t size = detail::compress_block(m_conf.compression, block->data, block->used, payload, capacity);
+    header->compression = static_cast<uint32_t>(m_conf.compression); // NOLINT(build/unsigned)
+    if (size == 0 || size >= block->used) {
+      std::memcpy(payload, block->data, block->used);
+      size = block->used;
+      header->compression = static_cast<uint32_t>(RecorderCompression::none); // NOLINT(build/unsigned)
+    }
+    const std::size_t frame = detail::align_up(sizeof(RecordedFrameHeader) + size);
+    std::memset(payload + size, 0, frame - sizeof(RecordedFrameHeader) - size);
+    header->magic = RecordedFrameHeader::s_magic;
+    header->sequence = block->sequence;
+    header->raw_size = block->used;
+    header->compressed_size = size;
+    header->frame_size = frame;
+    block->write_ptr = block->out;
+    block->write_len = frame;
+    block->offset = m_file_size.fetch_add(frame);
+  }
+
+  void written(Block* block, bool ok)
+  {
+    if (ok) {
+      m_written_bytes.fetch_add(block->write_len, std::memory_order_relaxed);
+      m_blocks_written.fetch_add(1, std::memory_order_relaxed);
+    } else if (m_write_errors.fetch_add(1, std::memory_order_relaxed) == 0) {
+      ers::error(CannotWriteToFile(ERS_HERE, m_conf.filename));
+    }
+    release(block);
+  }
+
+  bool write_all(const char* data, std::size_t len, uint64_t offset) // NOLINT(build/unsigned)
+  {
+    while (len > 0) {
+      const ssize_t n = ::pwrite(m_fd, data, len, static_cast<off_t>(offset));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      data += n;
+      len -= static_cast<std::size_t>(n);
+      offset += static_cast<uint64_t>(n); // NOLINT(build/unsigned)
+    }
+    return true;
+  }
+
+  void run_threads()
+  {
+    bool closed = false;
+    while (!closed) {
+      check_deadline();
+      Block* block = pop_filled(std::chrono::milliseconds(10), closed);
+      if (block != nullptr) {
+        prepare(block);
+        written(block, write_all(block->write_ptr, block->write_len, block->offset));
+      }
+    }
+  }
+
+  bool submit(Block* block)
+  {
+    return m_uring->write(m_fd,
+                          block->write_ptr + block->written,
+                          static_cast<unsigned>(block->write_len - block->written), // NOLINT(build/unsigned)
+                          block->offset + block->written,
+                          block->index);
+  }
+
+  // Writes synchronously what io_uring did not
+  bool write_rest(Block* block)
+  {
+    return write_all(
+      block->write_ptr + block->written, block->write_len - block->written, block->offset + block->written);
+  }
+
+  void run_io_uring()
+  {
+    std::size_t in_flight = 0; // Writes the kernel took, each completing once
+    bool use_uring = true;
+    bool closed = false;
+    auto completed = [&](uint64_t user_data, int result) { // NOLINT(build/unsigned)
+      Block* block = &m_blocks[user_data];
+      --in_flight;
+      if (result == -EINVAL && use_uring) {
+        // IORING_OP_WRITE came with Linux 5.6, older kernels refuse it
+        TLOG() << "io_uring refused a write (" << std::strerror(EINVAL) << "), falling back to synchronous writes";
+        use_uring = false;
+      }
+      if (result == 0 || (result < 0 && result != -EINVAL)) {
+        written(block, false);
+        return;
+      }
+      if (result > 0) {
+        block->written += static_cast<std::size_t>(result);
+      }
+      if (block->written < block->write_len && use_uring && submit(block)) {
+        ++in_flight; // Short write, the rest is in flight
+        return;
+      }
+      written(block, block->written == block->write_len || write_rest(block));
+    };
+
+    while (!closed || in_flight > 0) {
+      check_deadline();
+      uint64_t user_data = 0; // NOLINT(build/unsigned)
+      int result = 0;
+      while (m_uring->complete(user_data, result, false)) {
+        completed(user_data, result);
+      }
+      Block* block =
+        closed ? nullptr : pop_filled(in_flight > 0 ? std::chrono::milliseconds(0) : std::chrono::milliseconds(10), closed);
+      if (block != nullptr) {
+        prepare(block);
+        if (use_uring && submit(block)) {
+          ++in_flight;
+        } else {
+          written(block, write_rest(block));
+        }
+      } else if (in_flight > 0 && m_uring->complete(user_data, result, true)) {
+        completed(user_data, result);
+      }
+    }
+  }
+
+  RawRecorderConf m_conf;
+  RecorderEngine m_engine = RecorderEngine::io_uring;
+  int m_fd = -1;
+  bool m_direct_io = false;
+  std::atomic<uint64_t> m_file_size{ 0 }; // NOLINT(build/unsigned)
+
+  std::vector<Block> m_blocks;
+  std::unique_ptr<std::atomic<bool>[]> m_free; // Per block, set by whoever is done with it
+  std::mutex m_filled_mutex;
+  std::condition_variable m_filled_cv;
+  std::deque<Block*> m_filled;
+  bool m_workers_run = false;
+  std::vector<std::thread> m_workers;
+  std::unique_ptr<IoUring> m_uring;
+
+  // Recording window
+  std::atomic<bool> m_active{ false };
+  std::atomic<int64_t> m_deadline_ns{ 0 };
+
+  // Producer state
+  Block* m_current = nullptr;
+  Block* m_next = nullptr;     // Spare block, so that a full block is replaced without waiting
+  std::size_t m_next_free = 0; // Where to look for a free block first, blocks are taken in turn
+  uint64_t m_sequence = 0;     // NOLINT(build/unsigned)
+  bool m_pending = false;      // Data recorded since the last flush
+  alignas(detail::s_direct_io_alignment) char m_carry[detail::s_direct_io_alignment];
+  std::size_t m_carry_len = 0;
+
+  // Counters
+  std::atomic<uint64_t> m_recorded_bytes{ 0 };  // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_written_bytes{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_dropped_records{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_dropped_bytes{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_blocks_written{ 0 };  // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_write_errors{ 0 };    // NOLINT(build/unsigned)
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_RAWRECORDER_HPP_
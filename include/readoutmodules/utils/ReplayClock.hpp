@@ -0,0 +1,79 @@
+/**
+ * @file ReplayClock.hpp Common time base of the links replaying recorded
+ * data: maps a data timestamp to the TSC instant at which it is due, relative
+ * to the earliest first timestamp of all links and a shared start instant.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_REPLAYCLOCK_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_REPLAYCLOCK_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+#include "readoutmodules/utils/TscClock.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class ReplayClock
+{
+public:
+  /**
+   * @brief Reset the clock for a new configuration
+   * @param speed Replay speed multiplier, 2 replays twice as fast as recorded
+   * @param clock_speed_hz Frequency of the data timestamps
+   * @throws ConfigurationError if either is not strictly positive
+   */
+  void conf(double speed, double clock_speed_hz)
+  {
+    // Also rejects NaN
+    if (!(speed > 0.)) {
+      throw ConfigurationError(ERS_HERE, daqdataformats::SourceID(), "replay_speed must be > 0, got " + std::to_string(speed));
+    }
+    if (!(clock_speed_hz > 0.)) {
+      throw ConfigurationError(
+        ERS_HERE, daqdataformats::SourceID(), "clock_speed_hz must be > 0, got " + std::to_string(clock_speed_hz));
+    }
+    // Calibrated once per process, here rather than in the start command
+    TscClock::ticks_per_ns();
+    m_ns_per_tick = 1e9 / clock_speed_hz / speed;
+    m_reference_timestamp.store(std::numeric_limits<uint64_t>::max()); // NOLINT(build/unsigned)
+  }
+
+  //! Links register the first timestamp of their recording; the earliest one becomes the reference
+  void register_first_timestamp(uint64_t timestamp) // NOLINT(build/unsigned)
+  {
+    uint64_t current = m_reference_timestamp.load(); // NOLINT(build/unsigned)
+    while (timestamp < current && !m_reference_timestamp.compare_exchange_weak(current, timestamp)) {
+    }
+  }
+
+  //! Anchor the reference timestamp at delay from now, the same instant for every link
+  void start(std::chrono::nanoseconds delay)
+  {
+    m_start_tsc = TscClock::now() + TscClock::from_ns(delay.count());
+  }
+
+  uint64_t tsc_at(uint64_t timestamp) const // NOLINT(build/unsigned)
+  {
+    double ticks = static_cast<double>(static_cast<int64_t>(timestamp - m_reference_timestamp.load()));
+    return m_start_tsc + static_cast<int64_t>(ticks * m_ns_per_tick * TscClock::ticks_per_ns());
+  }
+
+private:
+  double m_ns_per_tick = 16.;
+  std::atomic<uint64_t> m_reference_timestamp{ std::numeric_limits<uint64_t>::max() }; // NOLINT(build/unsigned)
+  uint64_t m_start_tsc = 0;                                                            // NOLINT(build/unsigned)
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_REPLAYCLOCK_HPP_
@@ -0,0 +1,369 @@
+/**
+ * @file SaturationRateFinder.hpp Searches, during a run, the highest rate
+ * every emulated link sustains without loss. The rate of each link is
+ * ramped up or down by powers of two until it brackets the first lossy rate,
+ * then bisected. A window counts as lossy if the link could not send, if its
+ * data link handler overwrote or dropped elements (see LinkLossRegistry), if
+ * its output filled up past a threshold or if the link fell short of the
+ * rate asked. Once all links converged they are run together at their rates
+ * to confirm them, backing the lossy ones off. Only readouts implementing
+ * LossReportingReadoutConcept, i.e. ReferenceReadoutModel, publish their
+ * losses; the results of links whose handler losses were not observed say so.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SATURATIONRATEFINDER_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SATURATIONRATEFINDER_HPP_
+
+#include "readoutmodules/concepts/SourceEmulatorLinkConcept.hpp"
+#include "readoutmodules/utils/LinkLossRegistry.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+struct SaturationSearchConf
+{
+  double start_scale = 1.;   // First rate tried, as a factor of the nominal rate
+  double min_scale = 0.01;   // The search gives up below
+  double max_scale = 100.;   // The search stops above
+  double precision = 0.02;   // Relative distance between the lossless and lossy rates at which a link converged
+  double max_fill = 0.5;     // Output fill above which a window counts as lossy
+  double min_achieved = 0.95; // Fraction of the rate asked a link must reach
+  std::chrono::milliseconds settle{ 500 }; // Left to the chain after each rate change, not judged
+  std::chrono::milliseconds window{ 2000 }; // Judged after settle
+  int confirm_attempts = 3;  // Windows with all links together before giving up
+};
+
+enum class SaturationSearchState
+{
+  idle,
+  searching,
+  confirming,
+  done,
+  failed
+};
+
+struct SaturationLinkResult
+{
+  std::string name;
+  bool converged = false;
+  double nominal_rate_khz = 0.;
+  double scale = 0.;         // Highest lossless scale, 0 if none yet
+  double rate_khz = 0.;      // Rate measured at that scale
+  double current_scale = 0.; // Scale of the window running
+  uint64_t steps = 0;        // NOLINT(build/unsigned) Windows judged
+  uint64_t lossy_steps = 0;  // NOLINT(build/unsigned) Windows judged lossy
+  bool handler_losses_observed = false; // The last window saw the loss counters of the data link handler
+};
+
+struct SaturationSearchResult
+{
+  SaturationSearchState state = SaturationSearchState::idle;
+  double rate_khz = 0.;         // Sum of the highest lossless rates of the links
+  double nominal_rate_khz = 0.; // Sum of their nominal rates
+  uint64_t steps = 0;           // NOLINT(build/unsigned) Windows run
+  std::vector<SaturationLinkResult> links;
+};
+
+inline const char*
+saturation_search_state_name(SaturationSearchState state)
+{
+  switch (state) {
+    case SaturationSearchState::searching:
+      return "searching";
+    case SaturationSearchState::confirming:
+      return "confirming";
+    case SaturationSearchState::done:
+      return "done";
+    case SaturationSearchState::failed:
+      return "failed";
+    default:
+      return "idle";
+  }
+}
+
+class SaturationRateFinder
+{
+public:
+  //! A link under search; uid names its raw data connection, under which its handler publishes its losses
+  struct Probe
+  {
+    std::string name;
+    std::string uid;
+    SourceEmulatorLinkConcept* link;
+  };
+
+  SaturationRateFinder(std::vector<Probe> probes, const SaturationSearchConf& conf)
+    : m_probes(std::move(probes))
+    , m_conf(conf)
+  {}
+  ~SaturationRateFinder() { stop(); }
+
+  SaturationRateFinder(const SaturationRateFinder&) = delete;            ///< SaturationRateFinder is not copy-constructible
+  SaturationRateFinder& operator=(const SaturationRateFinder&) = delete; ///< SaturationRateFinder is not copy-assignable
+  SaturationRateFinder(SaturationRateFinder&&) = delete;                 ///< SaturationRateFinder is not move-constructible
+  SaturationRateFinder& operator=(SaturationRateFinder&&) = delete;      ///< SaturationRateFinder is not move-assignable
+
+  //! Start searching; the links must be running
+  void start()
+  {
+    stop();
+    {
+      std::lock_guard<std::mutex> lk(m_result_mutex);
+      m_result = SaturationSearchResult();
+      m_result.state = SaturationSearchState::searching;
+      for (const auto& probe : m_probes) {
+        SaturationLinkResult link;
+        link.name = probe.name;
+        link.nominal_rate_khz = probe.link->get_nominal_rate_khz();
+        link.current_scale = std::clamp(m_conf.start_scale, m_conf.min_scale, m_conf.max_scale);
+        m_result.nominal_rate_khz += link.nominal_rate_khz;
+        m_result.links.push_back(link);
+      }
+    }
+    m_run = true;
+    m_thread = std::thread(&SaturationRateFinder::run, this);
+    pthread_setname_np(m_thread.native_handle(), "fcr-ratesearch");
+  }
+
+  //! Stop searching; the links keep the rate they run at
+  void stop()
+  {
+    m_run = false;
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+  }
+
+  SaturationSearchResult get_result() const
+  {
+    std::lock_guard<std::mutex> lk(m_result_mutex);
+    return m_result;
+  }
+
+  /**
+   * @brief Move the scale of a link after a search window
+   * @param lossy_scale Lowest scale found lossy so far, 0 if none; updated
+   * @param lossless Whether the window at link.current_scale was lossless
+   */
+  static void search_step(const SaturationSearchConf& conf,
+                          SaturationLinkResult& link,
+                          double& lossy_scale,
+                          bool lossless,
+                          double achieved_khz)
+  {
+    if (lossless) {
+      link.scale = link.current_scale;
+      link.rate_khz = achieved_khz;
+    } else {
+      lossy_scale = link.current_scale;
+    }
+
+    if (lossy_scale == 0.) {
+      // Ramp up until some rate is lossy
+      link.converged = link.scale >= conf.max_scale;
+      link.current_scale = std::min(link.scale * 2., conf.max_scale);
+    } else if (link.scale == 0.) {
+      // Ramp down until some rate is lossless
+      link.converged = lossy_scale <= conf.min_scale;
+      link.current_scale = std::max(lossy_scale / 2., conf.min_scale);
+    } else {
+      link.converged = lossy_scale - link.scale <= conf.precision * lossy_scale;
+      link.current_scale = (link.scale + lossy_scale) / 2.;
+    }
+    if (link.converged) {
+      // A link lossy at the minimum scale stays there, it is not stopped
+      link.current_scale = std::max(link.scale, conf.min_scale);
+    }
+  }
+
+private:
+  // Counters of a link at the edges of a window
+  struct Snapshot
+  {
+    EmulatedLinkHealth health;
+    ReadoutLossCounters losses;
+    bool has_losses = false;
+  };
+
+  Snapshot take_snapshot(const Probe& probe) const
+  {
+    Snapshot snapshot;
+    snapshot.health = probe.link->get_link_health();
+    snapshot.has_losses = LinkLossRegistry::get().get_loss_counters(probe.uid, snapshot.losses);
+    return snapshot;
+  }
+
+  // Sleep for duration unless stopped; false if stopped
+  bool wait_for(std::chrono::milliseconds duration, std::vector<double>* max_fills = nullptr)
+  {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (m_run.load()) {
+      if (max_fills != nullptr) {
+        for (std::size_t i = 0; i < m_probes.size(); ++i) {
+          (*max_fills)[i] = std::max((*max_fills)[i], m_probes[i].link->get_link_health().fill);
+        }
+      }
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= end) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(s_sample_period, end - now));
+    }
+    return false;
+  }
+
+  // Run all links at their current scale for one window, judging each; false if stopped
+  bool run_window(std::vector<bool>& lossless, std::vector<double>& achieved_khz)
+  {
+    std::vector<double> scales;
+    {
+      std::lock_guard<std::mutex> lk(m_result_mutex);
+      for (std::size_t i = 0; i < m_probes.size(); ++i) {
+        scales.push_back(m_result.links[i].current_scale);
+        m_probes[i].link->set_rate_scale(scales.back());
+      }
+    }
+    if (!wait_for(m_conf.settle)) {
+      return false;
+    }
+
+    std::vector<Snapshot> before;
+    for (const auto& probe : m_probes) {
+      before.push_back(take_snapshot(probe));
+    }
+    std::vector<double> max_fills(m_probes.size(), -1.);
+    const auto begin = std::chrono::steady_clock::now();
+    if (!wait_for(m_conf.window, &max_fills)) {
+      return false;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<bool> observed(m_probes.size(), false);
+    for (std::size_t i = 0; i < m_probes.size(); ++i) {
+      const Snapshot after = take_snapshot(m_probes[i]);
+      const uint64_t sent = after.health.sent - before[i].health.sent; // NOLINT(build/unsigned)
+      achieved_khz[i] = sent / seconds / 1000.;
+      bool ok = after.health.send_failures == before[i].health.send_failures;
+      if (after.has_losses && before[i].has_losses) {
+        ok = ok && after.losses.overwritten == before[i].losses.overwritten &&
+             after.losses.dropped == before[i].losses.dropped;
+        observed[i] = true;
+      }
+      ok = ok && max_fills[i] <= m_conf.max_fill;
+      ok = ok && achieved_khz[i] >= m_conf.min_achieved * m_probes[i].link->get_nominal_rate_khz() * scales[i];
+      lossless[i] = ok;
+    }
+    std::lock_guard<std::mutex> lk(m_result_mutex);
+    for (std::size_t i = 0; i < m_probes.size(); ++i) {
+      m_result.links[i].handler_losses_observed = observed[i];
+    }
+    return true;
+  }
+
+  void run()
+  {
+    for (const auto& probe : m_probes) {
+      ReadoutLossCounters losses;
+      if (!LinkLossRegistry::get().get_loss_counters(probe.uid, losses)) {
+        TLOG() << "Rate search: the losses of the handler of " << probe.name
+               << " are not visible from this process, only the output of the link is watched";
+      }
+    }
+
+    std::vector<bool> lossless(m_probes.size(), false);
+    std::vector<double> achieved_khz(m_probes.size(), 0.);
+    std::vector<double> lossy_scales(m_probes.size(), 0.);
+
+    // Converged links keep running at their rate while the others search
+    bool searching = true;
+    while (searching) {
+      if (!run_window(lossless, achieved_khz)) {
+        return;
+      }
+      std::lock_guard<std::mutex> lk(m_result_mutex);
+      ++m_result.steps;
+      searching = false;
+      for (std::size_t i = 0; i < m_probes.size(); ++i) {
+        auto& link = m_result.links[i];
+        if (link.converged) {
+          continue;
+        }
+        ++link.steps;
+        link.lossy_steps += lossless[i] ? 0 : 1;
+        search_step(m_conf, link, lossy_scales[i], lossless[i], achieved_khz[i]);
+        searching = searching || !link.converged;
+      }
+    }
+
+    // Rates found one by one may not hold all together, back the lossy links off
+    {
+      std::lock_guard<std::mutex> lk(m_result_mutex);
+      m_result.state = SaturationSearchState::confirming;
+    }
+    bool confirmed = false;
+    for (int attempt = 0; attempt < m_conf.confirm_attempts && !confirmed; ++attempt) {
+      if (!run_window(lossless, achieved_khz)) {
+        return;
+      }
+      std::lock_guard<std::mutex> lk(m_result_mutex);
+      ++m_result.steps;
+      confirmed = true;
+      m_result.rate_khz = 0.;
+      for (std::size_t i = 0; i < m_probes.size(); ++i) {
+        auto& link = m_result.links[i];
+        ++link.steps;
+        if (lossless[i]) {
+          link.rate_khz = achieved_khz[i];
+        } else {
+          ++link.lossy_steps;
+          link.scale *= 1. - m_conf.precision;
+          link.current_scale = std::max(link.scale, m_conf.min_scale);
+          confirmed = false;
+        }
+        m_result.rate_khz += link.rate_khz;
+      }
+    }
+
+    std::lock_guard<std::mutex> lk(m_result_mutex);
+    m_result.state = confirmed ? SaturationSearchState::done : SaturationSearchState::failed;
+    for (const auto& link : m_result.links) {
+      TLOG() << "Rate search: " << link.name << " runs without loss up to " << link.rate_khz << " kHz, "
+             << link.scale << " times its nominal rate";
+    }
+    TLOG() << "Rate search " << saturation_search_state_name(m_result.state) << ": " << m_result.links.size()
+           << " links run without loss up to " << m_result.rate_khz << " kHz together, in " << m_result.steps
+           << " windows";
+  }
+
+  static constexpr std::chrono::milliseconds s_sample_period{ 10 };
+
+  std::vector<Probe> m_probes;
+  SaturationSearchConf m_conf;
+
+  mutable std::mutex m_result_mutex;
+  SaturationSearchResult m_result;
+
+  std::atomic<bool> m_run{ false };
+  std::thread m_thread;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SATURATIONRATEFINDER_HPP_
@@ -0,0 +1,106 @@
+/**
+ * @file SequentialFileReader.hpp Streams fixed-size elements from a raw
+ * recording through a block buffer, without loading the whole file.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SEQUENTIALFILEREADER_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SEQUENTIALFILEREADER_HPP_
+
+#include "readoutmodules/ReadoutModulesIssues.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class SequentialFileReader
+{
+public:
+  SequentialFileReader(const std::string& filename, std::size_t buffer_size)
+    : m_filename(filename)
+    , m_buffer(buffer_size)
+    , m_begin(0)
+    , m_end(0)
+  {
+    m_fd = ::open(m_filename.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+      throw CannotOpenFile(ERS_HERE, m_filename);
+    }
+    ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+
+  ~SequentialFileReader() { ::close(m_fd); }
+
+  SequentialFileReader(const SequentialFileReader&) = delete;            ///< SequentialFileReader is not copy-constructible
+  SequentialFileReader& operator=(const SequentialFileReader&) = delete; ///< SequentialFileReader is not copy-assignable
+  SequentialFileReader(SequentialFileReader&&) = delete;                 ///< SequentialFileReader is not move-constructible
+  SequentialFileReader& operator=(SequentialFileReader&&) = delete;      ///< SequentialFileReader is not move-assignable
+
+  /**
+   * @brief Copy the next size bytes of the file into dst
+   * @return false at the end of the file, a trailing partial element is dropped
+   */
+  bool read(void* dst, std::size_t size)
+  {
+    if (m_end - m_begin < size && !refill(size)) {
+      return false;
+    }
+    std::memcpy(dst, m_buffer.data() + m_begin, size);
+    m_begin += size;
+    return true;
+  }
+
+  void rewind()
+  {
+    ::lseek(m_fd, 0, SEEK_SET);
+    m_begin = m_end = 0;
+  }
+
+  const std::string& get_filename() const { return m_filename; }
+
+private:
+  bool refill(std::size_t size)
+  {
+    if (m_buffer.size() < size) {
+      m_buffer.resize(size);
+    }
+    std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+    m_end -= m_begin;
+    m_begin = 0;
+    while (m_end < size) {
+      ssize_t bytes = ::read(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end);
+      if (bytes < 0 && errno == EINTR) {
+        continue;
+      }
+      if (bytes < 0) {
+        throw CannotReadRecording(ERS_HERE, m_filename, std::strerror(errno));
+      }
+      if (bytes == 0) {
+        return false;
+      }
+      m_end += static_cast<std::size_t>(bytes);
+    }
+    return true;
+  }
+
+  std::string m_filename;
+  int m_fd;
+  std::vector<char> m_buffer;
+  std::size_t m_begin;
+  std::size_t m_end;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SEQUENTIALFILEREADER_HPP_
@@ -0,0 +1,89 @@
+/**
+ * @file SimdLevel.hpp Instruction set levels of the SIMD kernels. Runtime
+ * dispatched kernels are compiled for wider instruction sets with target
+ * attributes and picked by detecting the CPU once; the others, such as the
+ * frame expansion and hit finding of the frontend packages, run at the level
+ * the package flags build for.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SIMDLEVEL_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SIMDLEVEL_HPP_
+
+#include <algorithm>
+#include <string>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+enum class SimdLevel
+{
+  scalar = 0,
+  sse42,
+  avx2,
+  avx512
+};
+
+//! Level the code is compiled for by the build flags, that of the kernels which are not dispatched
+constexpr SimdLevel
+built_simd_level()
+{
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+  return SimdLevel::avx512;
+#elif defined(__AVX2__)
+  return SimdLevel::avx2;
+#elif defined(__SSE4_2__)
+  return SimdLevel::sse42;
+#else
+  return SimdLevel::scalar;
+#endif
+}
+
+//! Widest level the running CPU supports, detected on first use
+inline SimdLevel
+detect_simd_level()
+{
+  static const SimdLevel s_level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+      return SimdLevel::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return SimdLevel::avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+      return SimdLevel::sse42;
+    }
+    return SimdLevel::scalar;
+  }();
+  return s_level;
+}
+
+//! The requested level, lowered to what the running CPU supports
+inline SimdLevel
+supported_simd_level(SimdLevel requested)
+{
+  return std::min(requested, detect_simd_level());
+}
+
+inline std::string
+simd_level_name(SimdLevel level)
+{
+  switch (level) {
+    case SimdLevel::sse42:
+      return "sse4.2";
+    case SimdLevel::avx2:
+      return "avx2";
+    case SimdLevel::avx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SIMDLEVEL_HPP_
@@ -0,0 +1,116 @@
+/**
+ * @file SpscRing.hpp Bounded, lock-free ring of slots for exactly one
+ * producer and one consumer thread. Slots are written and read in place:
+ * the producer fills the slot returned by write_slot() and publishes it with
+ * commit(), the consumer reads the slot returned by read_slot() and hands it
+ * back with release().
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SPSCRING_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SPSCRING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+template<class T>
+class SpscRing
+{
+public:
+  //! The capacity is rounded up to a power of two
+  explicit SpscRing(std::size_t capacity)
+    : m_capacity(rounded_capacity(capacity))
+    , m_mask(m_capacity - 1)
+    , m_slots(new T[m_capacity])
+  {}
+
+  SpscRing(const SpscRing&) = delete;            ///< SpscRing is not copy-constructible
+  SpscRing& operator=(const SpscRing&) = delete; ///< SpscRing is not copy-assignable
+  SpscRing(SpscRing&&) = delete;                 ///< SpscRing is not move-constructible
+  SpscRing& operator=(SpscRing&&) = delete;      ///< SpscRing is not move-assignable
+
+  //! Producer: the next free slot, or nullptr if the ring is full
+  T* write_slot()
+  {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_cached_tail == m_capacity) {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head - m_cached_tail == m_capacity) {
+        return nullptr;
+      }
+    }
+    return &m_slots[head & m_mask];
+  }
+
+  //! Producer: publish the slot returned by the last write_slot()
+  void commit() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  //! Consumer: the oldest published slot, or nullptr if the ring is empty
+  T* read_slot()
+  {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_cached_head) {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail == m_cached_head) {
+        return nullptr;
+      }
+    }
+    return &m_slots[tail & m_mask];
+  }
+
+  //! Consumer: hand the slot returned by the last read_slot() back to the producer
+  void release() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  //! Visit every slot, published or not; only while neither side is running
+  template<class F>
+  void for_each_slot(F&& f)
+  {
+    for (std::size_t i = 0; i < m_capacity; ++i) {
+      f(m_slots[i]);
+    }
+  }
+
+  std::size_t capacity() const { return m_capacity; }
+  //! Published slots not yet released; exact only when called from one of the two sides
+  std::size_t occupancy() const
+  {
+    // The tail never passes the head, so loading the tail first keeps the difference from wrapping. From a third
+    // thread both sides may move between the loads, which can overstate it by up to what the producer published.
+    const std::size_t tail = m_tail.load(std::memory_order_acquire);
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+    return std::min(head - tail, m_capacity);
+  }
+
+  //! The capacity of a ring asked for capacity slots
+  static std::size_t rounded_capacity(std::size_t capacity)
+  {
+    std::size_t rounded = 1;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+private:
+  const std::size_t m_capacity;
+  const std::size_t m_mask;
+  std::unique_ptr<T[]> m_slots;
+
+  // Each side keeps its index and its last view of the other one on its own cache line
+  alignas(64) std::atomic<std::size_t> m_head{ 0 };
+  std::size_t m_cached_tail{ 0 };
+  alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+  std::size_t m_cached_head{ 0 };
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_SPSCRING_HPP_
@@ -0,0 +1,76 @@
+/**
+ * @file TscClock.hpp Time stamp counter based clock for busy-poll pacing.
+ * The counter frequency is calibrated once against the steady clock.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_TSCCLOCK_HPP_
+#define READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_TSCCLOCK_HPP_
+
+#include <x86intrin.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace dunedaq {
+namespace readoutmodules {
+
+class TscClock
+{
+public:
+  static uint64_t now() { return __rdtsc(); } // NOLINT(build/unsigned)
+
+  //! Counter ticks per nanosecond, calibrated on the first call of the process, which sleeps 20 ms
+  static double ticks_per_ns()
+  {
+    static const double s_ticks_per_ns = calibrate();
+    return s_ticks_per_ns;
+  }
+
+  static uint64_t from_ns(double ns) { return static_cast<uint64_t>(ns * ticks_per_ns()); } // NOLINT(build/unsigned)
+  static double to_ns(uint64_t ticks) { return ticks / ticks_per_ns(); }                   // NOLINT(build/unsigned)
+
+  /**
+   * @brief Wait until the counter reaches target: sleep through long gaps, busy-poll the rest
+   * @return false if the run marker was cleared while waiting
+   */
+  static bool wait_until(uint64_t target, const std::atomic<bool>& run_marker) // NOLINT(build/unsigned)
+  {
+    const uint64_t spin_ticks = from_ns(s_spin_threshold_ns); // NOLINT(build/unsigned)
+    uint64_t current = now();                                 // NOLINT(build/unsigned)
+    while (current < target) {
+      if (!run_marker.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      if (target - current > spin_ticks) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<int64_t>(to_ns(target - current - spin_ticks))));
+      } else {
+        _mm_pause();
+      }
+      current = now();
+    }
+    return true;
+  }
+
+private:
+  static double calibrate()
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = now(); // NOLINT(build/unsigned)
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t c1 = now(); // NOLINT(build/unsigned)
+    return (c1 - c0) / std::chrono::duration<double, std::nano>(t1 - t0).count();
+  }
+
+  static constexpr double s_spin_threshold_ns = 100000.;
+};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+#endif // READOUTMODULES_INCLUDE_READOUTMODULES_UTILS_TSCCLOCK_HPP_
@@ -13,6 +13,9 @@ moo.otypes.load_types("readoutlibs/sourceemulatorconfig.jsonnet")
 moo.otypes.load_types("readoutlibs/readoutconfig.jsonnet")
 moo.otypes.load_types('lbrulibs/pacmancardreader.jsonnet')
 moo.otypes.load_types("readoutlibs/recorderconfig.jsonnet")
+moo.otypes.load_types("readoutmodules/fakecardreaderconfig.jsonnet")
+moo.otypes.load_types("readoutmodules/datalinkhandlerconfig.jsonnet")
+moo.otypes.load_types("readoutmodules/multilinkhandlerconfig.jsonnet")
 
 # Import new types
 import dunedaq.readoutlibs.sourceemulatorconfig as sec
@@ -21,6 +24,9 @@ import dunedaq.dtpctrllibs.dtpcontroller as dtpctrl
 import dunedaq.readoutlibs.readoutconfig as rconf
 import dunedaq.lbrulibs.pacmancardreader as pcr
 import dunedaq.readoutlibs.recorderconfig as bfs
+import dunedaq.readoutmodules.fakecardreaderconfig as fcrconf
+import dunedaq.readoutmodules.datalinkhandlerconfig as dlhconf
+import dunedaq.readoutmodules.multilinkhandlerconfig as mlhconf
 
 from daqconf.core.app import App, ModuleGraph
 from daqconf.core.daqmodule import DAQModule
@@ -54,6 +60,24 @@ def generate(
     TPG_CHANNEL_MAP= "ProtoDUNESP1ChannelMap",
     LATENCY_BUFFER_SIZE=499968,
     DATA_REQUEST_TIMEOUT=1000,
+    SOURCE_BUFFER_HUGEPAGES=False,
+    EMULATOR_ENGINE="per_link",
+    EMULATOR_ENGINE_THREADS=1,
+    SOURCE_MODE="file",
+    REPLAY_SPEED=1.0,
+    GENERATOR_NOISE_RMS=4.0,
+    GENERATOR_PULSE_RATE_HZ=100.0,
+    BATCH_SIZE=1,
+    IN_PROCESS_RING=False,
+    PREFAULT_LATENCY_BUFFER=False,
+    LATENCY_BUFFER_NUMA_NODE=-1,
+    LATENCY_BUFFER_HUGEPAGES=False,
+    RAW_RECORDING_ENGINE="readout",
+    RAW_RECORDING_COMPRESSION="none",
+    MULTI_LINK_HANDLER=False,
+    MULTI_LINK_WORKERS=2,
+    RATE_SEARCH=False,
+    RATE_SEARCH_MAX_SCALE=100.0,
     SOURCEID_BROKER : SourceIDBroker = None,
     DEBUG=False
 ):
@@ -109,6 +133,28 @@ def generate(
 
     if DEBUG: print(f'FRONTENT_TYPE={FRONTEND_TYPE}')
 
+    # With MULTI_LINK_HANDLER one module handles all detector links, the endpoints of link i end in _link<i>
+    MULTI_LINK_HANDLER_NAME = f"datahandler_{RUIDX}"
+    link_index = {link.dro_source_id: i for i, link in enumerate(DRO_CONFIG.links)}
+    def dh_endpoint(sid, endpoint):
+        if MULTI_LINK_HANDLER:
+            return f"{MULTI_LINK_HANDLER_NAME}.{endpoint}_link{link_index[sid]}"
+        return f"datahandler_{sid}.{endpoint}"
+    multi_link_confs = []
+
+    # Only the fake card batches, and only on the detector links
+    LINK_BATCH_SIZE = 1 if FLX_INPUT or FRONTEND_TYPE == 'pacman' else BATCH_SIZE
+    # The fake card and its data link handlers live in this app, they can share rings instead of queues
+    LINK_TRANSPORT = "in_process_ring" if IN_PROCESS_RING and not FLX_INPUT and FRONTEND_TYPE != 'pacman' else "queue"
+    # The generated data link handlers read out with the readoutlibs ReadoutModel, which has no ring input
+    if LINK_TRANSPORT == "in_process_ring":
+        raise ValueError("in_process_ring needs readouts implementing RingInputReadoutConcept, the readoutlibs ReadoutModel of the data link handlers does not")
+    # Nor can it feed the recording pipeline of the data link handlers
+    if RAW_RECORDING_ENABLED and RAW_RECORDING_ENGINE != "readout":
+        raise ValueError("raw_recording_engine " + RAW_RECORDING_ENGINE + " needs readouts implementing RecordingReadoutConcept, the readoutlibs ReadoutModel of the data link handlers does not")
+    # In elements, the modules size the ring slots for the batch size
+    RING_CAPACITY = 8192
+
     if FLX_INPUT:
         link_0 = []
         link_1 = []
@@ -122,9 +168,9 @@ def generate(
                 link_1.append(link.dro_link)
                 sid_1.append(link.dro_source_id)
         for idx in sid_0:
-            queues += [Queue(f'flxcard_0.output_{idx}',f"datahandler_{idx}.raw_input",f'{FRONTEND_TYPE}_link_{idx}', 100000 )]
+            queues += [Queue(f'flxcard_0.output_{idx}',dh_endpoint(idx, "raw_input"),f'{FRONTEND_TYPE}_link_{idx}', 100000 )]
         for idx in sid_1:
-            queues += [Queue(f'flxcard_1.output_{idx}',f"datahandler_{idx}.raw_input",f'{FRONTEND_TYPE}_link_{idx}', 100000 )]
+            queues += [Queue(f'flxcard_1.output_{idx}',dh_endpoint(idx, "raw_input"),f'{FRONTEND_TYPE}_link_{idx}', 100000 )]
         if FIRMWARE_TPG_ENABLED:
             link_0.append(5)
             fw_tp_sid = fw_tp_id_map[FWTPID(DRO_CONFIG.host, DRO_CONFIG.card, 0)]
@@ -199,6 +245,20 @@ def generate(
                         # input_limit=10485100, # default
                         queue_timeout_ms = QUEUE_POP_WAIT_MS,
                         set_t0_to=0)
+        # FakeCardReaderBase settings travel in the same configuration object
+        conf = dict(conf.pod(), **fcrconf.Conf(source_buffer_hugepages=SOURCE_BUFFER_HUGEPAGES,
+                                               emulator_engine=EMULATOR_ENGINE,
+                                               engine_threads=EMULATOR_ENGINE_THREADS,
+                                               source_mode=SOURCE_MODE,
+                                               replay_speed=REPLAY_SPEED,
+                                               generator_noise_rms=GENERATOR_NOISE_RMS,
+                                               generator_pulse_rate_hz=GENERATOR_PULSE_RATE_HZ,
+                                               batch_size=LINK_BATCH_SIZE,
+                                               transport=LINK_TRANSPORT,
+                                               ring_capacity=RING_CAPACITY,
+                                               clock_speed_hz=CLOCK_SPEED_HZ,
+                                               rate_search=RATE_SEARCH,
+                                               rate_search_max_scale=RATE_SEARCH_MAX_SCALE).pod())
             
         if FRONTEND_TYPE=='pacman':
             fake_source = "pacman_source"
@@ -209,23 +269,21 @@ def generate(
         modules += [DAQModule(name = fake_source,
                               plugin = card_reader,
                               conf = conf)]
-        queues += [Queue(f"{fake_source}.output_{link.dro_source_id}",f"datahandler_{link.dro_source_id}.raw_input",f'{FRONTEND_TYPE}_link_{link.dro_source_id}', 100000) for link in DRO_CONFIG.links]
+        queues += [Queue(f"{fake_source}.output_{link.dro_source_id}",dh_endpoint(link.dro_source_id, "raw_input"),f'{FRONTEND_TYPE}_link_{link.dro_source_id}', 100000 // LINK_BATCH_SIZE) for link in DRO_CONFIG.links]
         queues += [Queue(f"{fake_source}.output_raw_tp_{tp_link}",f"tp_datahandler_{tp_link}.raw_input",f'tp_link_{tp_link}', 100000) for tp_link in link_to_tp_sid_map.values()]
 
     errored_consumer_needed = False
     if SOFTWARE_TPG_ENABLED:
-        queues += [Queue(f"datahandler_{link.dro_source_id}.tp_out",f"tp_datahandler_{link_to_tp_sid_map[link.dro_source_id]}.raw_input",f"sw_tp_link_{link.dro_source_id}",100000 )]                
+        queues += [Queue(dh_endpoint(link.dro_source_id, "tp_out"),f"tp_datahandler_{link_to_tp_sid_map[link.dro_source_id]}.raw_input",f"sw_tp_link_{link.dro_source_id}",100000 )]                
 
     for link in DRO_CONFIG.links:
         #? why only create errored frames for wib, should this also be created for wib2 or other FE's?
         if FRONTEND_TYPE == 'wib':
             errored_consumer_needed = True
-            queues += [Queue(f"datahandler_{link.dro_source_id}.errored_frames", 'errored_frame_consumer.input_queue', "errored_frames_q")]
+            queues += [Queue(dh_endpoint(link.dro_source_id, "errored_frames"), 'errored_frame_consumer.input_queue', "errored_frames_q")]
 
         tpset_topic = "None"
-        modules += [DAQModule(name = f"datahandler_{link.dro_source_id}",
-                          plugin = "DataLinkHandler", 
-                          conf = rconf.Conf(
+        dh_conf = dict(rconf.Conf(
                                   readoutmodelconf= rconf.ReadoutModelConf(
                                       source_queue_timeout_ms= QUEUE_POP_WAIT_MS,
                                       fake_trigger_flag=1,
@@ -259,8 +317,32 @@ def generate(
                                       output_file = path.join(RAW_RECORDING_OUTPUT_DIR, f"output_{RUIDX}_{link.dro_source_id}.out"),
                                       stream_buffer_size = 8388608,
                                       request_timeout_ms = DATA_REQUEST_TIMEOUT,
-                                      enable_raw_recording = RAW_RECORDING_ENABLED,
-                                  )), extra_commands={"record": rconf.RecordingParams(duration=10)})]
+                                      enable_raw_recording = RAW_RECORDING_ENABLED and RAW_RECORDING_ENGINE == "readout",
+                                  )).pod(),
+                                  # DataLinkHandlerBase settings travel in the same configuration object
+                                  **dlhconf.Conf(batch_size=LINK_BATCH_SIZE,
+                                                 raw_input_transport=LINK_TRANSPORT,
+                                                 ring_capacity=RING_CAPACITY,
+                                                 prefault_latency_buffer=PREFAULT_LATENCY_BUFFER,
+                                                 prefault_numa_node=LATENCY_BUFFER_NUMA_NODE,
+                                                 prefault_hugepages=LATENCY_BUFFER_HUGEPAGES,
+                                                 recording_engine=RAW_RECORDING_ENGINE if RAW_RECORDING_ENABLED else "readout",
+                                                 recording_output_file=path.join(RAW_RECORDING_OUTPUT_DIR, f"output_{RUIDX}_{link.dro_source_id}.out"),
+                                                 recording_compression=RAW_RECORDING_COMPRESSION).pod())
+        if MULTI_LINK_HANDLER:
+            multi_link_confs.append(mlhconf.LinkConf(name=f"datahandler_{link.dro_source_id}", conf=dh_conf))
+        else:
+            modules += [DAQModule(name = f"datahandler_{link.dro_source_id}",
+                                  plugin = "DataLinkHandler",
+                                  conf = dh_conf,
+                                  extra_commands={"record": rconf.RecordingParams(duration=10)})]
+
+    if MULTI_LINK_HANDLER:
+        modules += [DAQModule(name = MULTI_LINK_HANDLER_NAME,
+                              plugin = "MultiLinkHandler",
+                              conf = mlhconf.Conf(links=multi_link_confs,
+                                                  workers=MULTI_LINK_WORKERS),
+                              extra_commands={"record": rconf.RecordingParams(duration=10)})]
 
     if SOFTWARE_TPG_ENABLED:
         for link in DRO_CONFIG.links:
@@ -389,13 +471,13 @@ def generate(
             mgraph.add_endpoint(f"tp_requests_{link_to_tp_sid_map[link.dro_source_id]}", f"tp_datahandler_{link_to_tp_sid_map[link.dro_source_id]}.request_input", Direction.IN)
             mgraph.add_endpoint(f"tp_requests_{link_to_tp_sid_map[link.dro_source_id]}", None, Direction.OUT) # Fake request endpoint
             
-            mgraph.add_endpoint(f"tpsets_link{link.dro_source_id}", f"datahandler_{link.dro_source_id}.tpset_out",    Direction.OUT, topic=["TPSets"])
+            mgraph.add_endpoint(f"tpsets_link{link.dro_source_id}", dh_endpoint(link.dro_source_id, "tpset_out"),    Direction.OUT, topic=["TPSets"])
             mgraph.add_endpoint(f"tpsets_link{link.dro_source_id}", None,    Direction.IN, topic=["TPSets"]) # Fake TPSet endpoint
         
-        mgraph.connect_modules(f"datahandler_{link.dro_source_id}.timesync_output", "timesync_consumer.input_queue", "timesync_q")
-        mgraph.connect_modules(f"datahandler_{link.dro_source_id}.fragment_queue", "fragment_consumer.input_queue", "data_fragments_q", 100)
+        mgraph.connect_modules(dh_endpoint(link.dro_source_id, "timesync_output"), "timesync_consumer.input_queue", "timesync_q")
+        mgraph.connect_modules(dh_endpoint(link.dro_source_id, "fragment_queue"), "fragment_consumer.input_queue", "data_fragments_q", 100)
 
-        mgraph.add_endpoint(f"requests_{link.dro_source_id}", f"datahandler_{link.dro_source_id}.request_input", Direction.IN)
+        mgraph.add_endpoint(f"requests_{link.dro_source_id}", dh_endpoint(link.dro_source_id, "request_input"), Direction.IN)
         mgraph.add_endpoint(f"requests_{link.dro_source_id}", None, Direction.OUT) # Fake request endpoint
 
     ru_app = App(modulegraph=mgraph, host=HOST, name="readout_app")
@@ -0,0 +1,120 @@
+/**
+ * @file raw_recorder_benchmark_app.cxx Feeds WIB2-sized elements at a fixed
+ * rate into the raw recording pipeline, for each engine and available
+ * compression. One JSON line per setup is printed with the rates recorded and
+ * written to disk and the fraction of elements dropped.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/RawRecorder.hpp"
+
+#include "logging/Logging.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+struct Element
+{
+  uint8_t bytes[5616]; // NOLINT(build/unsigned)
+};
+
+const char*
+engine_name(RecorderEngine engine)
+{
+  return engine == RecorderEngine::io_uring ? "io_uring" : "threads";
+}
+
+const char*
+compression_name(RecorderCompression compression)
+{
+  switch (compression) {
+    case RecorderCompression::lz4:
+      return "lz4";
+    case RecorderCompression::zstd:
+      return "zstd";
+    default:
+      return "none";
+  }
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  std::string filename = (argc > 1) ? argv[1] : "raw_recorder_benchmark.out";
+  double offered_gbytes_per_s = (argc > 2) ? std::stod(argv[2]) : 1.0;
+  double seconds = (argc > 3) ? std::stod(argv[3]) : 5.0;
+  TLOG() << "Recording to " << filename << " at " << offered_gbytes_per_s << " GB/s for " << seconds << " s per setup";
+
+  // Noise-like content, so that compression ratios are not flattering
+  std::vector<Element> elements(256);
+  uint32_t state = 12345; // NOLINT(build/unsigned)
+  for (auto& element : elements) {
+    for (auto& byte : element.bytes) {
+      state = state * 1664525 + 1013904223;
+      byte = static_cast<uint8_t>((state >> 24) & 0x3f); // NOLINT(build/unsigned)
+    }
+  }
+  const auto period = std::chrono::duration<double>(sizeof(Element) / (offered_gbytes_per_s * 1e9));
+
+  for (auto engine : { RecorderEngine::io_uring, RecorderEngine::threads }) {
+    for (auto compression : { RecorderCompression::none, RecorderCompression::lz4, RecorderCompression::zstd }) {
+      if (!detail::compression_available(compression)) {
+        continue;
+      }
+      RawRecorderConf conf;
+      conf.filename = filename;
+      conf.engine = engine;
+      conf.compression = compression;
+      conf.threads = 4;
+
+      RawRecorder recorder;
+      recorder.open(conf);
+      recorder.start(std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000) + 1000));
+      const auto begin = std::chrono::steady_clock::now();
+      auto next = begin;
+      std::size_t offered = 0;
+      while (std::chrono::steady_clock::now() - begin < std::chrono::duration<double>(seconds)) {
+        // Offer elements in bursts of 16, as a link does after a queue pop
+        for (int i = 0; i < 16; ++i, ++offered) {
+          recorder.record(&elements[offered % elements.size()], sizeof(Element));
+        }
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(16 * period);
+        while (std::chrono::steady_clock::now() < next) {
+        }
+      }
+      const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      recorder.stop();
+      const auto used_engine = recorder.get_engine();
+      const bool direct_io = recorder.is_direct_io();
+      recorder.close();
+      const auto stats = recorder.get_stats();
+
+      nlohmann::json result;
+      result["engine"] = engine_name(used_engine);
+      result["compression"] = compression_name(compression);
+      result["direct_io"] = direct_io;
+      result["offered_gbytes_per_s"] = offered * sizeof(Element) / elapsed / 1e9;
+      result["recorded_gbytes_per_s"] = stats.recorded_bytes / elapsed / 1e9;
+      result["written_gbytes_per_s"] = stats.written_bytes / elapsed / 1e9;
+      result["dropped_fraction"] = offered > 0 ? static_cast<double>(stats.dropped_records) / offered : 0.;
+      result["write_errors"] = stats.write_errors;
+      std::cout << result.dump() << std::endl;
+    }
+  }
+  std::remove(filename.c_str());
+  return 0;
+}
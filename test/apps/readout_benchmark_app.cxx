@@ -0,0 +1,823 @@
+/**
+ * @file readout_benchmark_app.cxx End-to-end benchmark of the readout path.
+ * A FakeCardReaderBase generating data feeds one DataLinkHandlerBase per
+ * link, in-process, while data requests are issued against every link.
+ * One JSON line per frontend type and link count is printed with the
+ * achieved frames/s and GB/s, the request latency percentiles, the CPU
+ * spent per link and the threads of the process, so that results can be
+ * compared across builds. The links are read out by the readoutlibs
+ * ReadoutModel or by the ReferenceReadoutModel, each in a DataLinkHandler
+ * of its own or all in one MultiLinkHandler, optionally recording all
+ * they receive through the recording pipeline of the handlers.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/DataLinkHandlerBase.hpp"
+#include "readoutmodules/FakeCardReaderBase.hpp"
+#include "readoutmodules/MultiLinkHandlerBase.hpp"
+#include "readoutmodules/models/ReferenceReadoutModel.hpp"
+#include "readoutmodules/models/SourceEmulatorLinkModel.hpp"
+#include "readoutmodules/utils/FrameBatch.hpp"
+#include "readoutmodules/utils/FrameGeneratorTraits.hpp"
+
+#include "readoutlibs/models/DefaultRequestHandlerModel.hpp"
+#include "readoutlibs/models/FixedRateQueueModel.hpp"
+#include "readoutlibs/models/ReadoutModel.hpp"
+#include "readoutlibs/models/TaskRawDataProcessorModel.hpp"
+
+#include "appfwk/app/Nljs.hpp"
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/SourceID.hpp"
+#include "dfmessages/DataRequest.hpp"
+#include "dfmessages/TimeSync.hpp"
+#include "iomanager/IOManager.hpp"
+#include "logging/Logging.hpp"
+#include "opmonlib/InfoCollector.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace readoutmodules {
+namespace benchmark {
+
+/**
+ * @brief Readout element with the geometry of a frontend superchunk:
+ * NumFrames frames of FrameSize bytes, each starting with its timestamp.
+ * The frontend types themselves live in the frontend packages.
+ */
+template<std::size_t FrameSize, std::size_t NumFrames, uint64_t TickDiff> // NOLINT(build/unsigned)
+struct BenchmarkElement
+{
+  struct Frame
+  {
+    uint64_t timestamp;                          // NOLINT(build/unsigned)
+    uint8_t payload[FrameSize - sizeof(uint64_t)]; // NOLINT(build/unsigned)
+
+    uint64_t get_timestamp() const { return timestamp; }     // NOLINT(build/unsigned)
+    void set_timestamp(uint64_t ts) { timestamp = ts; }      // NOLINT(build/unsigned)
+  };
+
+  bool operator<(const BenchmarkElement& other) const { return get_first_timestamp() < other.get_first_timestamp(); }
+
+  uint64_t get_first_timestamp() const { return frames[0].timestamp; } // NOLINT(build/unsigned)
+  void set_first_timestamp(uint64_t ts) { frames[0].timestamp = ts; }  // NOLINT(build/unsigned)
+  uint64_t get_timestamp() const { return get_first_timestamp(); }     // NOLINT(build/unsigned)
+  void set_timestamp(uint64_t ts) { set_first_timestamp(ts); }         // NOLINT(build/unsigned)
+
+  void fake_timestamps(uint64_t first_timestamp, uint64_t offset = TickDiff) // NOLINT(build/unsigned)
+  {
+    for (std::size_t i = 0; i < NumFrames; ++i) {
+      frames[i].timestamp = first_timestamp + i * offset;
+    }
+  }
+  void fake_frame_errors(std::vector<uint16_t>* /*fake_errors*/) {} // NOLINT(build/unsigned)
+
+  Frame* begin() { return &frames[0]; }
+  Frame* end() { return &frames[NumFrames]; }
+
+  std::size_t get_payload_size() const { return FrameSize * NumFrames; }
+  std::size_t get_num_frames() const { return NumFrames; }
+  std::size_t get_frame_size() const { return FrameSize; }
+
+  static const constexpr daqdataformats::SourceID::Subsystem subsystem =
+    daqdataformats::SourceID::Subsystem::kDetectorReadout;
+  static const constexpr daqdataformats::FragmentType fragment_type = daqdataformats::FragmentType::kWIB;
+  static const constexpr uint64_t expected_tick_difference = TickDiff; // NOLINT(build/unsigned)
+  static const constexpr std::size_t frames_per_element = NumFrames;
+
+  Frame frames[NumFrames];
+};
+
+using WIBLikeElement = BenchmarkElement<464, 12, 25>;
+using WIB2LikeElement = BenchmarkElement<468, 12, 32>;
+
+using WIBLikeBatch4 = FrameBatch<WIBLikeElement, 4>;
+using WIBLikeBatch16 = FrameBatch<WIBLikeElement, 16>;
+using WIBLikeBatch64 = FrameBatch<WIBLikeElement, 64>;
+using WIB2LikeBatch4 = FrameBatch<WIB2LikeElement, 4>;
+using WIB2LikeBatch16 = FrameBatch<WIB2LikeElement, 16>;
+using WIB2LikeBatch64 = FrameBatch<WIB2LikeElement, 64>;
+
+} // namespace benchmark
+
+// 256 channels of one 14-bit sample per frame, right after the frame timestamp
+template<std::size_t FrameSize, std::size_t NumFrames, uint64_t TickDiff> // NOLINT(build/unsigned)
+struct FrameGeneratorTraits<benchmark::BenchmarkElement<FrameSize, NumFrames, TickDiff>>
+  : PackedAdcGeneratorTraits<256, 1, NumFrames, FrameSize, sizeof(uint64_t), 14> // NOLINT(build/unsigned)
+{};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIBLikeElement, "BenchmarkWIBLikeElement")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIB2LikeElement, "BenchmarkWIB2LikeElement")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIBLikeBatch4, "BenchmarkWIBLikeBatch4")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIBLikeBatch16, "BenchmarkWIBLikeBatch16")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIBLikeBatch64, "BenchmarkWIBLikeBatch64")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIB2LikeBatch4, "BenchmarkWIB2LikeBatch4")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIB2LikeBatch16, "BenchmarkWIB2LikeBatch16")
+DUNE_DAQ_TYPESTRING(dunedaq::readoutmodules::benchmark::WIB2LikeBatch64, "BenchmarkWIB2LikeBatch64")
+
+using namespace dunedaq;
+using namespace dunedaq::readoutmodules;
+using namespace dunedaq::readoutmodules::benchmark;
+
+namespace {
+
+struct Options
+{
+  std::vector<std::string> frontends{ "wib", "wib2" };
+  std::vector<std::size_t> links{ 1, 2, 4 };
+  std::vector<std::size_t> batch_sizes{ 1 };
+  double seconds = 10.;
+  double warmup_seconds = 2.;
+  double request_rate_hz = 10.;   // per link
+  uint64_t window_ticks = 6400;   // NOLINT(build/unsigned)
+  double request_lag_ms = 50.;    // behind the estimated newest data
+  int request_timeout_ms = 1000;
+  std::size_t latency_buffer_size = 32768;
+  std::string engine = "per_link";
+  int engine_threads = 1;
+  std::string readout = "readoutlibs";
+  std::string handler = "per_link";
+  int workers = 2;
+  std::string transport = "queue";
+  bool instrumented = true;
+  bool prefault = false;
+  std::string record = "off";
+  std::string record_dir = ".";
+  std::string output;
+};
+
+// Sum of every numeric field named key, at any depth of an opmon dump
+double
+sum_field(const nlohmann::json& j, const std::string& key)
+{
+  double sum = 0.;
+  if (j.is_object()) {
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      if (it.key() == key && it.value().is_number()) {
+        sum += it.value().get<double>();
+      } else {
+        sum += sum_field(it.value(), key);
+      }
+    }
+  } else if (j.is_array()) {
+    for (const auto& elem : j) {
+      sum += sum_field(elem, key);
+    }
+  }
+  return sum;
+}
+
+double
+cpu_seconds()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Threads of the process, from /proc
+std::size_t
+count_threads()
+{
+  std::size_t threads = 0;
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return 0;
+  }
+  while (dirent* entry = readdir(dir)) {
+    threads += (entry->d_name[0] != '.') ? 1 : 0;
+  }
+  closedir(dir);
+  return threads;
+}
+
+double
+percentile(const std::vector<double>& sorted, double fraction)
+{
+  if (sorted.empty()) {
+    return 0.;
+  }
+  return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(fraction * sorted.size()))];
+}
+
+template<class ElementType>
+class BenchmarkFakeCardReader : public FakeCardReaderBase
+{
+public:
+  BenchmarkFakeCardReader(const std::string& name, double rate_khz)
+    : FakeCardReaderBase(name)
+    , m_rate_khz(rate_khz)
+  {}
+
+  std::unique_ptr<readoutlibs::SourceEmulatorConcept> create_source_emulator(
+    const appfwk::app::ConnectionReference qi,
+    std::atomic<bool>& run_marker) override
+  {
+    return make_batched<ElementType>(
+      get_batch_size(), [&](auto tag) -> std::unique_ptr<readoutlibs::SourceEmulatorConcept> {
+        using RDT = typename decltype(tag)::type;
+        return std::make_unique<SourceEmulatorLinkModel<RDT>>(
+          qi.name, run_marker, ElementType::expected_tick_difference, m_rate_khz);
+      });
+  }
+
+private:
+  double m_rate_khz;
+};
+
+// The readout of one link: the readoutlibs ReadoutModel, or the ReferenceReadoutModel
+template<class ElementType>
+std::unique_ptr<readoutlibs::ReadoutConcept>
+create_benchmark_readout(const std::string& readout_type,
+                         bool instrumented,
+                         const nlohmann::json& args,
+                         std::size_t batch_size,
+                         std::atomic<bool>& run_marker)
+{
+  return make_batched<ElementType>(batch_size, [&](auto tag) -> std::unique_ptr<readoutlibs::ReadoutConcept> {
+    using RDT = typename decltype(tag)::type;
+    std::unique_ptr<readoutlibs::ReadoutConcept> readout;
+    if (readout_type == "reference") {
+      readout = std::make_unique<ReferenceReadoutModel<RDT>>(run_marker, instrumented);
+    } else if constexpr (batch_size_of<RDT>::value == 1) {
+      using lb_t = readoutlibs::FixedRateQueueModel<RDT>;
+      readout = std::make_unique<readoutlibs::ReadoutModel<RDT,
+                                                           readoutlibs::DefaultRequestHandlerModel<RDT, lb_t>,
+                                                           lb_t,
+                                                           readoutlibs::TaskRawDataProcessorModel<RDT>>>(run_marker);
+    } else {
+      return nullptr; // The readoutlibs ReadoutModel would store the batches as they are
+    }
+    readout->init(args);
+    return readout;
+  });
+}
+
+template<class ElementType>
+class BenchmarkDataLinkHandler : public DataLinkHandlerBase
+{
+public:
+  BenchmarkDataLinkHandler(const std::string& name, const std::string& readout_type, bool instrumented)
+    : DataLinkHandlerBase(name)
+    , m_readout_type(readout_type)
+    , m_instrumented(instrumented)
+  {}
+
+  std::unique_ptr<readoutlibs::ReadoutConcept> create_readout(const nlohmann::json& args,
+                                                              std::atomic<bool>& run_marker) override
+  {
+    return create_benchmark_readout<ElementType>(m_readout_type, m_instrumented, args, get_batch_size(), run_marker);
+  }
+
+private:
+  std::string m_readout_type;
+  bool m_instrumented;
+};
+
+template<class ElementType>
+class BenchmarkMultiLinkHandler : public MultiLinkHandlerBase
+{
+public:
+  BenchmarkMultiLinkHandler(const std::string& name, const std::string& readout_type, bool instrumented)
+    : MultiLinkHandlerBase(name)
+    , m_readout_type(readout_type)
+    , m_instrumented(instrumented)
+  {}
+
+  std::unique_ptr<readoutlibs::ReadoutConcept> create_readout(std::size_t /*link*/,
+                                                              const nlohmann::json& args,
+                                                              std::size_t batch_size,
+                                                              std::atomic<bool>& run_marker) override
+  {
+    return create_benchmark_readout<ElementType>(m_readout_type, m_instrumented, args, batch_size, run_marker);
+  }
+
+private:
+  std::string m_readout_type;
+  bool m_instrumented;
+};
+
+iomanager::connection::QueueConfig
+queue_config(const std::string& uid, const std::string& data_type, iomanager::connection::QueueType type, uint32_t capacity) // NOLINT(build/unsigned)
+{
+  iomanager::connection::QueueConfig config;
+  config.id.uid = uid;
+  config.id.data_type = data_type;
+  config.queue_type = type;
+  config.capacity = capacity;
+  return config;
+}
+
+// Type string of what the fake card pushes for a batch size
+template<class ElementType>
+std::string
+raw_data_type(std::size_t batch_size)
+{
+  switch (batch_size) {
+    case 4:
+      return datatype_to_string<FrameBatch<ElementType, 4>>();
+    case 16:
+      return datatype_to_string<FrameBatch<ElementType, 16>>();
+    case 64:
+      return datatype_to_string<FrameBatch<ElementType, 64>>();
+    default:
+      return datatype_to_string<ElementType>();
+  }
+}
+
+nlohmann::json
+mod_init(const std::vector<std::pair<std::string, std::string>>& refs)
+{
+  appfwk::app::ModInit ini;
+  for (const auto& [name, uid] : refs) {
+    appfwk::app::ConnectionReference ref;
+    ref.name = name;
+    ref.uid = uid;
+    ini.conn_refs.push_back(ref);
+  }
+  nlohmann::json args = ini;
+  return args;
+}
+
+/**
+ * @brief Run one frontend type with num_links links and return its results
+ */
+template<class ElementType>
+nlohmann::json
+run_benchmark(const Options& opts,
+              const std::string& frontend,
+              std::size_t num_links,
+              std::size_t batch_size,
+              double clock_speed_hz)
+{
+  using clock = std::chrono::steady_clock;
+  const double rate_khz = clock_speed_hz / ElementType::expected_tick_difference / ElementType::frames_per_element / 1e3;
+  const std::string fragments_uid = "bench_fragments";
+  const std::string timesync_uid = "bench_timesync";
+  // Queues hold batches, keep them covering the same time; the latency buffers hold the unpacked elements
+  const std::size_t latency_buffer_size = opts.latency_buffer_size;
+
+  // Connections
+  iomanager::connection::Queues_t queues;
+  for (std::size_t i = 0; i < num_links; ++i) {
+    queues.push_back(queue_config("bench_raw_" + std::to_string(i),
+                                  raw_data_type<ElementType>(batch_size),
+                                  iomanager::connection::QueueType::kFollySPSCQueue,
+                                  100000 / batch_size));
+    queues.push_back(queue_config("bench_requests_" + std::to_string(i),
+                                  datatype_to_string<dfmessages::DataRequest>(),
+                                  iomanager::connection::QueueType::kFollySPSCQueue,
+                                  1000));
+  }
+  queues.push_back(queue_config(fragments_uid,
+                                datatype_to_string<std::unique_ptr<daqdataformats::Fragment>>(),
+                                iomanager::connection::QueueType::kFollyMPMCQueue,
+                                10000));
+  queues.push_back(queue_config(
+    timesync_uid, datatype_to_string<dfmessages::TimeSync>(), iomanager::connection::QueueType::kFollyMPMCQueue, 10000));
+  get_iomanager()->configure(queues, iomanager::connection::Connections_t{}, false, std::chrono::milliseconds(1000));
+
+  // Modules: one DataLinkHandler per link, or one MultiLinkHandler for all of them
+  const bool multi_link = (opts.handler == "multi_link");
+  BenchmarkFakeCardReader<ElementType> card("bench_fakecard", rate_khz);
+  std::vector<std::pair<std::string, std::string>> card_refs;
+  std::vector<std::unique_ptr<BenchmarkDataLinkHandler<ElementType>>> handlers;
+  BenchmarkMultiLinkHandler<ElementType> multi_handler("bench_multilinkhandler", opts.readout, opts.instrumented);
+  std::vector<std::pair<std::string, std::string>> multi_refs{ { "fragment_queue", fragments_uid },
+                                                               { "timesync_output", timesync_uid } };
+  nlohmann::json link_confs = nlohmann::json::array();
+  for (std::size_t i = 0; i < num_links; ++i) {
+    card_refs.emplace_back("output_" + std::to_string(i), "bench_raw_" + std::to_string(i));
+    link_confs.push_back({ { "source_id", i }, { "slowdown", 1.0 }, { "queue_name", "output_" + std::to_string(i) } });
+
+    if (multi_link) {
+      multi_refs.emplace_back("raw_input_link" + std::to_string(i), "bench_raw_" + std::to_string(i));
+      multi_refs.emplace_back("request_input_link" + std::to_string(i), "bench_requests_" + std::to_string(i));
+      continue;
+    }
+    handlers.push_back(std::make_unique<BenchmarkDataLinkHandler<ElementType>>(
+      "bench_datahandler_" + std::to_string(i), opts.readout, opts.instrumented));
+    handlers.back()->init(mod_init({ { "raw_input", "bench_raw_" + std::to_string(i) },
+                                     { "request_input", "bench_requests_" + std::to_string(i) },
+                                     { "fragment_queue", fragments_uid },
+                                     { "timesync_output", timesync_uid } }));
+  }
+  card.init(mod_init(card_refs));
+  if (multi_link) {
+    multi_handler.init(mod_init(multi_refs));
+  }
+
+  // Recordings, removed after the run
+  const bool recording = (opts.record != "off");
+  auto recording_file = [&](std::size_t i) {
+    return opts.record_dir + "/bench_recording_" + frontend + "_" + std::to_string(i) + ".bin";
+  };
+
+  auto handler_conf = [&](std::size_t i) -> nlohmann::json {
+    return { { "batch_size", batch_size },
+             { "raw_input_transport", opts.transport },
+             { "prefault_latency_buffer", opts.prefault },
+             { "recording_engine", recording ? opts.record : "readout" },
+             { "recording_output_file", recording ? recording_file(i) : "" },
+             { "readoutmodelconf", { { "source_queue_timeout_ms", 100 }, { "source_id", i } } },
+             { "latencybufferconf", { { "latency_buffer_size", latency_buffer_size }, { "source_id", i } } },
+             { "rawdataprocessorconf", { { "source_id", i }, { "emulator_mode", false } } },
+             { "requesthandlerconf",
+               { { "latency_buffer_size", latency_buffer_size },
+                 { "pop_limit_pct", 0.8 },
+                 { "pop_size_pct", 0.1 },
+                 { "source_id", i },
+                 { "request_timeout_ms", opts.request_timeout_ms },
+                 { "warn_on_timeout", false },
+                 { "enable_raw_recording", false } } } };
+  };
+
+  auto handler_infos = [&]() {
+    opmonlib::InfoCollector handler_ci;
+    if (multi_link) {
+      multi_handler.get_info(handler_ci, 1);
+    }
+    // Each handler under its name, as opmon does, or the infos of one would replace those of another
+    for (auto& handler : handlers) {
+      opmonlib::InfoCollector link_ci;
+      handler->get_info(link_ci, 1);
+      handler_ci.add(handler->get_dlh_name(), link_ci);
+    }
+    return handler_ci;
+  };
+
+  const auto conf_begin = clock::now();
+  if (multi_link) {
+    nlohmann::json multi_links = nlohmann::json::array();
+    for (std::size_t i = 0; i < num_links; ++i) {
+      multi_links.push_back({ { "name", "bench_datahandler_" + std::to_string(i) }, { "conf", handler_conf(i) } });
+    }
+    multi_handler.do_conf({ { "links", multi_links }, { "workers", opts.workers } });
+  }
+  for (std::size_t i = 0; i < handlers.size(); ++i) {
+    handlers[i]->do_conf(handler_conf(i));
+  }
+  const auto card_conf_begin = clock::now();
+  card.do_conf({ { "batch_size", batch_size },
+                 { "link_confs", link_confs },
+                 { "queue_timeout_ms", 100 },
+                 { "set_t0_to", 0 },
+                 { "source_mode", "generator" },
+                 { "transport", opts.transport },
+                 { "clock_speed_hz", clock_speed_hz },
+                 { "emulator_engine", opts.engine },
+                 { "engine_threads", opts.engine_threads } });
+  const auto conf_end = clock::now();
+
+  // Time spent prefaulting, within the conf of the handlers
+  const double prefault_ms = sum_field(handler_infos().get_collected_infos(), "prefault_ms");
+
+  // Request bookkeeping, indexed by trigger number
+  const std::size_t max_requests =
+    static_cast<std::size_t>(opts.request_rate_hz * num_links * (opts.seconds + opts.warmup_seconds + 1.)) + 1;
+  std::vector<std::atomic<int64_t>> sent_ns(max_requests);
+  std::vector<double> latencies_us;
+  latencies_us.reserve(max_requests);
+  std::atomic<bool> measuring{ false };
+  std::atomic<bool> running{ true };
+  std::atomic<uint64_t> requests_sent{ 0 }; // NOLINT(build/unsigned)
+  const auto epoch = clock::now();
+
+  nlohmann::json start_args = { { "run", 1 } };
+  if (multi_link) {
+    multi_handler.do_start(start_args);
+  }
+  for (auto& handler : handlers) {
+    handler->do_start(start_args);
+  }
+  const auto data_start = clock::now();
+  card.do_start(start_args);
+
+  std::thread collector([&]() {
+    auto receiver = get_iom_receiver<std::unique_ptr<daqdataformats::Fragment>>(fragments_uid);
+    while (running.load()) {
+      try {
+        auto fragment = receiver->receive(std::chrono::milliseconds(10));
+        auto trigger = fragment->get_trigger_number();
+        if (trigger < max_requests && measuring.load()) {
+          auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+          latencies_us.push_back((now - sent_ns[trigger].load()) / 1e3);
+        }
+      } catch (const iomanager::TimeoutExpired&) {
+      }
+    }
+  });
+  std::thread timesync_drain([&]() {
+    auto receiver = get_iom_receiver<dfmessages::TimeSync>(timesync_uid);
+    while (running.load()) {
+      try {
+        receiver->receive(std::chrono::milliseconds(10));
+      } catch (const iomanager::TimeoutExpired&) {
+      }
+    }
+  });
+  std::thread requester([&]() {
+    std::vector<std::shared_ptr<iomanager::SenderConcept<dfmessages::DataRequest>>> senders;
+    for (std::size_t i = 0; i < num_links; ++i) {
+      senders.push_back(get_iom_sender<dfmessages::DataRequest>("bench_requests_" + std::to_string(i)));
+    }
+    const auto interval = std::chrono::duration<double>(1. / (opts.request_rate_hz * num_links));
+    const double lag_ticks = opts.request_lag_ms * clock_speed_hz / 1e3;
+    auto next = clock::now();
+    for (uint64_t trigger = 0; running.load() && trigger < max_requests; ++trigger) { // NOLINT(build/unsigned)
+      std::this_thread::sleep_until(next);
+      next += std::chrono::duration_cast<clock::duration>(interval);
+
+      // The links emit at their nominal rate from t0 = 0, aim just behind the newest data
+      double newest = std::chrono::duration<double>(clock::now() - data_start).count() * clock_speed_hz;
+      if (newest < lag_ticks + opts.window_ticks) {
+        continue;
+      }
+      std::size_t link = trigger % num_links;
+      dfmessages::DataRequest request;
+      request.trigger_number = trigger;
+      request.sequence_number = 0;
+      request.run_number = 1;
+      request.trigger_timestamp = static_cast<uint64_t>(newest - lag_ticks); // NOLINT(build/unsigned)
+      request.request_information.component =
+        daqdataformats::SourceID(ElementType::subsystem, static_cast<uint32_t>(link)); // NOLINT(build/unsigned)
+      request.request_information.window_end = request.trigger_timestamp;
+      request.request_information.window_begin = request.trigger_timestamp - opts.window_ticks;
+      request.data_destination = fragments_uid;
+
+      sent_ns[trigger] = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+      try {
+        senders[link]->send(std::move(request), std::chrono::milliseconds(10));
+        requests_sent++;
+      } catch (const ers::Issue& excpt) {
+        ers::warning(excpt);
+      }
+    }
+  });
+
+  // Recording counters are since the previous get_info, the last snapshot holds those of the measurement
+  double recorded_bytes = 0.;
+  double written_bytes = 0.;
+  double dropped_elements = 0.;
+  auto snapshot = [&]() {
+    opmonlib::InfoCollector card_ci;
+    card.get_info(card_ci, 1);
+    const auto handler_json = handler_infos().get_collected_infos();
+    recorded_bytes = sum_field(handler_json, "recorded_bytes");
+    written_bytes = sum_field(handler_json, "written_bytes");
+    dropped_elements = sum_field(handler_json, "dropped_elements");
+    return std::make_tuple(sum_field(card_ci.get_collected_infos(), "packets"),
+                           sum_field(handler_json, "sum_payloads"),
+                           cpu_seconds(),
+                           clock::now());
+  };
+
+  if (recording) {
+    const nlohmann::json record_args = { { "duration",
+                                           static_cast<int>(std::ceil(opts.warmup_seconds + opts.seconds)) + 1 } };
+    if (multi_link) {
+      multi_handler.do_record(record_args);
+    }
+    for (auto& handler : handlers) {
+      handler->do_record(record_args);
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(opts.warmup_seconds));
+  auto [sent_0, received_0, cpu_0, time_0] = snapshot();
+  uint64_t requests_0 = requests_sent.load(); // NOLINT(build/unsigned)
+  measuring = true;
+  std::this_thread::sleep_for(std::chrono::duration<double>(opts.seconds));
+  measuring = false;
+  auto [sent_1, received_1, cpu_1, time_1] = snapshot();
+  uint64_t requests_1 = requests_sent.load(); // NOLINT(build/unsigned)
+  // The benchmark itself runs the main, request, collector and timesync drain threads
+  const std::size_t threads = count_threads();
+
+  card.do_stop(start_args);
+  if (multi_link) {
+    multi_handler.do_stop(start_args);
+  }
+  for (auto& handler : handlers) {
+    handler->do_stop(start_args);
+  }
+  running = false;
+  requester.join();
+  collector.join();
+  timesync_drain.join();
+  card.do_scrap(start_args);
+  if (multi_link) {
+    multi_handler.do_scrap(start_args);
+  }
+  for (auto& handler : handlers) {
+    handler->do_scrap(start_args);
+  }
+  get_iomanager()->reset();
+  if (recording) {
+    for (std::size_t i = 0; i < num_links; ++i) {
+      std::remove(recording_file(i).c_str());
+    }
+  }
+
+  // Results
+  const double elapsed = std::chrono::duration<double>(time_1 - time_0).count();
+  // The card counts batches, the latency buffers elements
+  const double elements = received_1 - received_0;
+  std::sort(latencies_us.begin(), latencies_us.end());
+
+  nlohmann::json result;
+  result["frontend"] = frontend;
+  result["links"] = num_links;
+  result["engine"] = opts.engine;
+  result["readout"] = opts.readout;
+  result["handler"] = opts.handler;
+  result["transport"] = opts.transport;
+  if (opts.readout == "reference") {
+    result["instrumented"] = opts.instrumented;
+  }
+  if (multi_link) {
+    result["workers"] = opts.workers;
+  }
+  result["batch_size"] = batch_size;
+  result["seconds"] = elapsed;
+  result["nominal_rate_khz_per_link"] = rate_khz;
+  result["elements_sent"] = (sent_1 - sent_0) * batch_size;
+  result["elements_received"] = elements;
+  result["frames_per_s"] = elements * ElementType::frames_per_element / elapsed;
+  result["gbytes_per_s"] = elements * sizeof(ElementType) / elapsed / 1e9;
+  result["requests_sent"] = requests_1 - requests_0;
+  result["fragments_received"] = latencies_us.size();
+  result["request_latency_us"] = { { "p50", percentile(latencies_us, 0.50) },
+                                   { "p90", percentile(latencies_us, 0.90) },
+                                   { "p99", percentile(latencies_us, 0.99) },
+                                   { "p999", percentile(latencies_us, 0.999) },
+                                   { "max", latencies_us.empty() ? 0. : latencies_us.back() } };
+  result["cpu_per_link"] = (cpu_1 - cpu_0) / elapsed / num_links;
+  result["threads"] = threads;
+  if (opts.prefault) {
+    result["prefault_ms"] = prefault_ms;
+  }
+  if (recording) {
+    result["record"] = opts.record;
+    result["recorded_gbytes_per_s"] = recorded_bytes / elapsed / 1e9;
+    result["recording_written_gbytes_per_s"] = written_bytes / elapsed / 1e9;
+    result["recording_dropped_elements"] = dropped_elements;
+  }
+  result["handlers_conf_ms"] = std::chrono::duration<double, std::milli>(card_conf_begin - conf_begin).count();
+  result["card_conf_ms"] = std::chrono::duration<double, std::milli>(conf_end - card_conf_begin).count();
+  return result;
+}
+
+template<class T>
+std::vector<T>
+split(const std::string& list)
+{
+  std::vector<T> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    std::stringstream conv(item);
+    T value;
+    conv >> value;
+    items.push_back(value);
+  }
+  return items;
+}
+
+void
+usage(const char* app)
+{
+  std::cerr << "Usage: " << app << " [options]\n"
+            << "  --frontends LIST          frontend types to run, from wib,wib2 (default: wib,wib2)\n"
+            << "  --links LIST              link counts to run (default: 1,2,4)\n"
+            << "  --batch-sizes LIST        batch sizes to run, from 1,4,16,64, above 1 needs the reference readout (default: 1)\n"
+            << "  --seconds S               measurement time per run (default: 10)\n"
+            << "  --warmup S                time before measuring (default: 2)\n"
+            << "  --request-rate HZ         data requests per second per link (default: 10)\n"
+            << "  --window-ticks N          width of the requested windows (default: 6400)\n"
+            << "  --request-lag-ms MS       age of the requested data (default: 50)\n"
+            << "  --latency-buffer-size N   latency buffer elements per link (default: 32768)\n"
+            << "  --engine per_link|multiplexed  fake card emulator engine (default: per_link)\n"
+            << "  --engine-threads N        engine threads in multiplexed mode (default: 1)\n"
+            << "  --readout readoutlibs|reference  readout of each link (default: readoutlibs)\n"
+            << "  --handler per_link|multi_link    one DataLinkHandler per link, or one MultiLinkHandler (default: per_link)\n"
+            << "  --workers N               MultiLinkHandler workers polling the reference readouts (default: 2)\n"
+            << "  --prefault on|off         prefault the latency buffers at conf (default: off)\n"
+            << "  --instrumentation on|off  time the hot path of the reference readouts (default: on)\n"
+            << "  --transport queue|in_process_ring  raw data from the fake card to the readouts, rings need the reference readout (default: queue)\n"
+            << "  --record off|io_uring|threads  record every link through the recording pipeline, reference readout only (default: off)\n"
+            << "  --record-dir DIR          directory of the recordings, removed after each run (default: .)\n"
+            << "  --output FILE             append the JSON lines to FILE instead of stdout\n";
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help" || i + 1 == argc) {
+      usage(argv[0]);
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+    std::string value = argv[++i];
+    if (arg == "--frontends") {
+      opts.frontends = split<std::string>(value);
+    } else if (arg == "--links") {
+      opts.links = split<std::size_t>(value);
+    } else if (arg == "--batch-sizes") {
+      opts.batch_sizes = split<std::size_t>(value);
+    } else if (arg == "--seconds") {
+      opts.seconds = std::stod(value);
+    } else if (arg == "--warmup") {
+      opts.warmup_seconds = std::stod(value);
+    } else if (arg == "--request-rate") {
+      opts.request_rate_hz = std::stod(value);
+    } else if (arg == "--window-ticks") {
+      opts.window_ticks = std::stoull(value);
+    } else if (arg == "--request-lag-ms") {
+      opts.request_lag_ms = std::stod(value);
+    } else if (arg == "--latency-buffer-size") {
+      opts.latency_buffer_size = std::stoull(value);
+    } else if (arg == "--engine") {
+      opts.engine = value;
+    } else if (arg == "--engine-threads") {
+      opts.engine_threads = std::stoi(value);
+    } else if (arg == "--readout") {
+      opts.readout = value;
+    } else if (arg == "--handler") {
+      opts.handler = value;
+    } else if (arg == "--workers") {
+      opts.workers = std::stoi(value);
+    } else if (arg == "--prefault") {
+      opts.prefault = (value == "on");
+    } else if (arg == "--instrumentation") {
+      opts.instrumented = (value == "on");
+    } else if (arg == "--transport") {
+      opts.transport = value;
+    } else if (arg == "--record") {
+      opts.record = value;
+    } else if (arg == "--record-dir") {
+      opts.record_dir = value;
+    } else if (arg == "--output") {
+      opts.output = value;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (opts.readout != "reference" &&
+      std::any_of(opts.batch_sizes.begin(), opts.batch_sizes.end(), [](std::size_t size) { return size != 1; })) {
+    std::cerr << "Batches are only unpacked by the reference readout, use --readout reference\n";
+    return 1;
+  }
+
+  std::ofstream output_file;
+  if (!opts.output.empty()) {
+    output_file.open(opts.output, std::ios::app);
+  }
+  std::ostream& out = opts.output.empty() ? std::cout : output_file;
+
+  for (const auto& frontend : opts.frontends) {
+    for (auto num_links : opts.links) {
+      for (auto batch_size : opts.batch_sizes) {
+        TLOG() << "Running " << frontend << " with " << num_links << " links and batches of " << batch_size
+               << " for " << opts.seconds << " s";
+        nlohmann::json result;
+        if (frontend == "wib") {
+          result = run_benchmark<WIBLikeElement>(opts, frontend, num_links, batch_size, 50000000.);
+        } else if (frontend == "wib2") {
+          result = run_benchmark<WIB2LikeElement>(opts, frontend, num_links, batch_size, 62500000.);
+        } else {
+          TLOG() << "Unknown frontend type " << frontend << ", skipping";
+          break;
+        }
+        out << result.dump() << std::endl;
+      }
+    }
+  }
+  return 0;
+}
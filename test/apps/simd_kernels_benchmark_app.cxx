@@ -0,0 +1,92 @@
+/**
+ * @file simd_kernels_benchmark_app.cxx Compares the instruction set variants
+ * of the runtime dispatched kernels on the running CPU. One JSON line per
+ * variant is printed with its time per WIB2-sized element and the resulting
+ * element rate per core, next to the scalar reference.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/AdcNoiseGenerator.hpp"
+#include "readoutmodules/utils/FrameGeneratorTraits.hpp"
+#include "readoutmodules/utils/SimdLevel.hpp"
+
+#include "logging/Logging.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+// 12 frames of 256 channels with one 14-bit sample each, as in a WIB2 superchunk
+constexpr std::size_t s_channels = 256;
+constexpr std::size_t s_samples = 12;
+constexpr std::size_t s_frame_size = 468;
+constexpr std::size_t s_adc_offset = 16;
+
+struct Element
+{
+  uint8_t bytes[s_samples * s_frame_size]; // NOLINT(build/unsigned)
+};
+
+using traits_t = PackedAdcGeneratorTraits<s_channels, 1, s_samples, s_frame_size, s_adc_offset, 14>;
+
+template<class Function>
+double
+ns_per_call(Function&& function, std::size_t iterations)
+{
+  for (std::size_t i = 0; i < iterations / 10; ++i) {
+    function();
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    function();
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  std::size_t iterations = (argc > 1) ? std::stoull(argv[1]) : 100000;
+  TLOG() << "Detected SIMD level: " << simd_level_name(detect_simd_level()) << ", " << iterations << " iterations";
+
+  std::vector<uint16_t> adcs(s_samples * s_channels); // NOLINT(build/unsigned)
+  Element element{};
+  double scalar_ns = 0.;
+
+  for (auto level : { SimdLevel::scalar, SimdLevel::sse42, SimdLevel::avx2, SimdLevel::avx512 }) {
+    if (supported_simd_level(level) != level) {
+      TLOG() << "Skipping " << simd_level_name(level) << ", not supported by this CPU";
+      continue;
+    }
+    AdcNoiseGenerator generator;
+    generator.conf(900., 4., traits_t::adc_bits, 1e-4, 200, 1, level);
+
+    double fill_ns = ns_per_call([&]() { generator.fill(adcs.data(), s_samples, s_channels); }, iterations);
+    double pack_ns = ns_per_call([&]() { traits_t::pack(adcs.data(), element); }, iterations);
+    if (level == SimdLevel::scalar) {
+      scalar_ns = fill_ns;
+    }
+
+    nlohmann::json result;
+    result["kernel"] = "adc_noise_fill";
+    result["simd_level"] = simd_level_name(level);
+    result["fill_ns_per_element"] = fill_ns;
+    result["pack_ns_per_element"] = pack_ns;
+    result["elements_per_s_per_core"] = 1e9 / (fill_ns + pack_ns);
+    result["fill_speedup_vs_scalar"] = scalar_ns / fill_ns;
+    std::cout << result.dump() << std::endl;
+  }
+  return 0;
+}
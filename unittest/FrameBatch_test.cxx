@@ -0,0 +1,196 @@
+/**
+ * @file FrameBatch_test.cxx Unit tests of FrameBatch: the readout type
+ * interface over its elements, their contiguous frames, the elements an
+ * input carries, the generator traits of batches, and the batch sizes
+ * instantiated by make_batched.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/FrameBatch.hpp"
+
+#define BOOST_TEST_MODULE FrameBatch_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+// Three frames of a timestamp and eight 16-bit ADCs, back to back as in a superchunk
+struct FakeElement
+{
+  struct Frame
+  {
+    uint64_t timestamp; // NOLINT(build/unsigned)
+    uint16_t adcs[8];   // NOLINT(build/unsigned)
+  };
+
+  bool operator<(const FakeElement& other) const { return get_first_timestamp() < other.get_first_timestamp(); }
+
+  uint64_t get_first_timestamp() const { return frames[0].timestamp; } // NOLINT(build/unsigned)
+  void set_first_timestamp(uint64_t ts) { frames[0].timestamp = ts; }  // NOLINT(build/unsigned)
+  uint64_t get_timestamp() const { return frames[0].timestamp; }      // NOLINT(build/unsigned)
+  void set_timestamp(uint64_t ts) { frames[0].timestamp = ts; }        // NOLINT(build/unsigned)
+
+  void fake_timestamps(uint64_t first_timestamp, uint64_t offset) // NOLINT(build/unsigned)
+  {
+    for (auto& frame : frames) {
+      frame.timestamp = first_timestamp;
+      first_timestamp += offset;
+    }
+  }
+  void fake_frame_errors(std::vector<uint16_t>* /*fake_errors*/) {} // NOLINT(build/unsigned)
+
+  Frame* begin() { return &frames[0]; }
+  Frame* end() { return &frames[s_frames]; }
+
+  std::size_t get_payload_size() { return sizeof(frames); }
+  std::size_t get_num_frames() { return s_frames; }
+  std::size_t get_frame_size() { return sizeof(Frame); }
+
+  static const constexpr int subsystem = 1;
+  static const constexpr int fragment_type = 2;
+  static const constexpr uint64_t expected_tick_difference = 25; // NOLINT(build/unsigned)
+  static const constexpr std::size_t s_frames = 3;
+
+  Frame frames[s_frames];
+};
+
+// Readouts of the tests, telling which batch size they were instantiated for
+struct Made
+{
+  virtual ~Made() = default;
+  virtual std::size_t batch_size() const = 0;
+};
+
+template<class ReadoutType>
+struct MadeFor : Made
+{
+  std::size_t batch_size() const override { return batch_size_of<ReadoutType>::value; }
+};
+
+std::unique_ptr<Made>
+make(std::size_t batch_size)
+{
+  return make_batched<FakeElement>(batch_size, [](auto tag) -> std::unique_ptr<Made> {
+    return std::make_unique<MadeFor<typename decltype(tag)::type>>();
+  });
+}
+
+} // namespace
+
+namespace dunedaq {
+namespace readoutmodules {
+
+// The ADCs of every frame, 16 bits wide after the timestamp
+template<>
+struct FrameGeneratorTraits<FakeElement>
+  : PackedAdcGeneratorTraits<4, 2, FakeElement::s_frames, sizeof(FakeElement::Frame), sizeof(uint64_t), 16> // NOLINT
+{};
+
+} // namespace readoutmodules
+} // namespace dunedaq
+
+BOOST_AUTO_TEST_SUITE(FrameBatch_test)
+
+BOOST_AUTO_TEST_CASE(BatchSizes)
+{
+  BOOST_REQUIRE_EQUAL(batch_size_of<FakeElement>::value, 1);
+  BOOST_REQUIRE_EQUAL((batch_size_of<FrameBatch<FakeElement, 4>>::value), 4);
+  BOOST_REQUIRE_EQUAL((batch_size_of<FrameBatch<FakeElement, 64>>::value), 64);
+  BOOST_REQUIRE_EQUAL(sizeof(FrameBatch<FakeElement, 16>), 16 * sizeof(FakeElement));
+}
+
+BOOST_AUTO_TEST_CASE(ElementsOfAnInput)
+{
+  static_assert(std::is_same_v<batch_element_of<FakeElement>::type, FakeElement>, "An element carries itself");
+  static_assert(std::is_same_v<batch_element_of<FrameBatch<FakeElement, 16>>::type, FakeElement>,
+                "A batch carries its elements");
+  FakeElement element;
+  BOOST_REQUIRE(batch_element_of<FakeElement>::elements(element) == &element);
+  using batch_t = FrameBatch<FakeElement, 16>;
+  batch_t batch;
+  BOOST_REQUIRE(batch_element_of<batch_t>::elements(batch) == &batch.elements[0]);
+}
+
+BOOST_AUTO_TEST_CASE(MakesTheConfiguredBatchSize)
+{
+  for (std::size_t batch_size : { 1, 4, 16, 64 }) {
+    auto made = make(batch_size);
+    BOOST_REQUIRE(made != nullptr);
+    BOOST_REQUIRE_EQUAL(made->batch_size(), batch_size);
+  }
+  for (std::size_t batch_size : { 0, 2, 8, 128 }) {
+    BOOST_REQUIRE(make(batch_size) == nullptr);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FramesOfTheElementsAreContiguous)
+{
+  FrameBatch<FakeElement, 4> batch;
+  BOOST_REQUIRE_EQUAL(batch.get_num_frames(), 4 * FakeElement::s_frames);
+  BOOST_REQUIRE_EQUAL(batch.get_frame_size(), sizeof(FakeElement::Frame));
+  BOOST_REQUIRE_EQUAL(batch.get_payload_size(), sizeof(batch));
+  BOOST_REQUIRE_EQUAL(batch.end() - batch.begin(), 4 * FakeElement::s_frames);
+  BOOST_REQUIRE(batch.begin() == batch.elements[0].begin());
+  BOOST_REQUIRE(batch.end() == batch.elements[3].end());
+}
+
+BOOST_AUTO_TEST_CASE(TimestampsRunOnAcrossElements)
+{
+  FrameBatch<FakeElement, 4> batch;
+  batch.fake_timestamps(1000);
+  uint64_t expected = 1000; // NOLINT(build/unsigned)
+  for (const auto& frame : batch) {
+    BOOST_REQUIRE_EQUAL(frame.timestamp, expected);
+    expected += FakeElement::expected_tick_difference;
+  }
+  BOOST_REQUIRE_EQUAL(batch.get_first_timestamp(), 1000);
+  BOOST_REQUIRE_EQUAL(batch.get_timestamp(), 1000);
+
+  batch.set_first_timestamp(42);
+  BOOST_REQUIRE_EQUAL(batch.elements[0].get_first_timestamp(), 42);
+
+  FrameBatch<FakeElement, 4> later;
+  later.fake_timestamps(2000);
+  BOOST_REQUIRE(batch < later);
+  BOOST_REQUIRE(!(later < batch));
+}
+
+BOOST_AUTO_TEST_CASE(GeneratorPacksEveryElement)
+{
+  using traits_t = FrameGeneratorTraits<FrameBatch<FakeElement, 4>>;
+  static_assert(traits_t::available, "Batches of synthesizable elements are synthesizable");
+  BOOST_REQUIRE_EQUAL(traits_t::num_channels, 4);
+  BOOST_REQUIRE_EQUAL(traits_t::samples_per_element, 4 * 2 * FakeElement::s_frames);
+  BOOST_REQUIRE_EQUAL(traits_t::adc_bits, 16);
+
+  std::vector<uint16_t> adcs(traits_t::samples_per_element * traits_t::num_channels); // NOLINT(build/unsigned)
+  for (std::size_t i = 0; i < adcs.size(); ++i) {
+    adcs[i] = static_cast<uint16_t>(i); // NOLINT(build/unsigned)
+  }
+  FrameBatch<FakeElement, 4> batch;
+  batch.fake_timestamps(7);
+  traits_t::pack(adcs.data(), batch);
+
+  // The ADCs follow each other over the frames of all elements, and the timestamps are left alone
+  std::size_t adc = 0;
+  uint64_t expected = 7; // NOLINT(build/unsigned)
+  for (const auto& frame : batch) {
+    BOOST_REQUIRE_EQUAL(frame.timestamp, expected);
+    expected += FakeElement::expected_tick_difference;
+    for (auto value : frame.adcs) {
+      BOOST_REQUIRE_EQUAL(value, adc++);
+    }
+  }
+  BOOST_REQUIRE_EQUAL(adc, adcs.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
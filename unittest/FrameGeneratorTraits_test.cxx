@@ -0,0 +1,134 @@
+/**
+ * @file FrameGeneratorTraits_test.cxx Unit tests of pack_adcs against a bit
+ * by bit packing, for the widths of the supported frontends and others, with
+ * and without a partial last group, and of PackedAdcGeneratorTraits placing
+ * the ADCs of each frame.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/FrameGeneratorTraits.hpp"
+
+#define BOOST_TEST_MODULE FrameGeneratorTraits_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+// Values wider than the ADCs, whose extra bits must be dropped
+std::vector<uint16_t> // NOLINT(build/unsigned)
+make_adcs(std::size_t count)
+{
+  std::vector<uint16_t> adcs(count); // NOLINT(build/unsigned)
+  for (std::size_t i = 0; i < count; ++i) {
+    adcs[i] = static_cast<uint16_t>(0xa5c3 ^ (i * 2654435761u)); // NOLINT(build/unsigned)
+  }
+  return adcs;
+}
+
+// Bit i of the output is bit i % bits of value i / bits
+std::vector<uint8_t> // NOLINT(build/unsigned)
+reference_pack(const std::vector<uint16_t>& adcs, unsigned bits) // NOLINT(build/unsigned)
+{
+  std::vector<uint8_t> packed((adcs.size() * bits + 7) / 8, 0); // NOLINT(build/unsigned)
+  for (std::size_t bit = 0; bit < adcs.size() * bits; ++bit) {
+    if ((adcs[bit / bits] >> (bit % bits)) & 1) {
+      packed[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8)); // NOLINT(build/unsigned)
+    }
+  }
+  return packed;
+}
+
+// Packs into a buffer filled with a guard pattern, which must survive past the packed bytes
+template<unsigned Bits, std::size_t Count>
+void
+check_pack()
+{
+  BOOST_TEST_CONTEXT(Count << " values of " << Bits << " bits")
+  {
+    const auto adcs = make_adcs(Count);
+    const auto expected = reference_pack(adcs, Bits);
+    std::vector<uint8_t> packed(expected.size() + 16, 0xee); // NOLINT(build/unsigned)
+    pack_adcs<Bits, Count>(adcs.data(), packed.data());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(
+      packed.begin(), packed.begin() + expected.size(), expected.begin(), expected.end());
+    for (std::size_t i = expected.size(); i < packed.size(); ++i) {
+      BOOST_REQUIRE_EQUAL(packed[i], 0xee);
+    }
+  }
+}
+
+template<unsigned Bits>
+void
+check_counts()
+{
+  check_pack<Bits, 1>();
+  check_pack<Bits, 7>();
+  check_pack<Bits, 64>();
+  check_pack<Bits, 65>();
+  check_pack<Bits, 256>();
+  check_pack<Bits, 256 * 2 + 13>();
+}
+
+// Two frames of 40 bytes, 12-bit ADCs of 4 channels x 2 samples each after an 8 byte header
+struct FakeElement
+{
+  uint8_t bytes[2][40]; // NOLINT(build/unsigned)
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FrameGeneratorTraits_test)
+
+BOOST_AUTO_TEST_CASE(PacksWholeGroups)
+{
+  check_pack<12, 16>();
+  check_pack<14, 32>();
+  check_pack<10, 32>();
+  check_pack<16, 4>();
+}
+
+BOOST_AUTO_TEST_CASE(PacksEveryWidth)
+{
+  check_counts<1>();
+  check_counts<3>();
+  check_counts<7>();
+  check_counts<8>();
+  check_counts<10>();
+  check_counts<12>();
+  check_counts<13>();
+  check_counts<14>();
+  check_counts<15>();
+  check_counts<16>();
+}
+
+BOOST_AUTO_TEST_CASE(TraitsPackEveryFrameAtItsOffset)
+{
+  using traits_t = PackedAdcGeneratorTraits<4, 2, 2, 40, 8, 12>;
+  BOOST_REQUIRE_EQUAL(traits_t::samples_per_element, 4);
+  BOOST_REQUIRE_EQUAL(traits_t::num_channels, 4);
+
+  const auto adcs = make_adcs(traits_t::samples_per_element * traits_t::num_channels);
+  FakeElement element;
+  std::memset(&element, 0xee, sizeof(element));
+  traits_t::pack(adcs.data(), element);
+
+  for (std::size_t frame = 0; frame < 2; ++frame) {
+    const std::vector<uint16_t> frame_adcs(adcs.begin() + frame * 8, adcs.begin() + (frame + 1) * 8); // NOLINT
+    const auto expected = reference_pack(frame_adcs, 12);
+    const uint8_t* bytes = element.bytes[frame]; // NOLINT(build/unsigned)
+    for (std::size_t i = 0; i < 40; ++i) {
+      const bool adc_byte = i >= 8 && i < 8 + expected.size();
+      BOOST_REQUIRE_EQUAL(bytes[i], adc_byte ? expected[i - 8] : 0xee);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
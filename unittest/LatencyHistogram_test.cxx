@@ -0,0 +1,119 @@
+/**
+ * @file LatencyHistogram_test.cxx Unit tests of LatencyHistogram: bucket
+ * precision, percentiles of a known distribution, reset by take() and
+ * recording from several threads.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/LatencyHistogram.hpp"
+
+#define BOOST_TEST_MODULE LatencyHistogram_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+// The relative error of a bucket is below 1 / 32
+void
+require_close(double measured_ns, uint64_t expected_ticks) // NOLINT(build/unsigned)
+{
+  const double expected_ns = TscClock::to_ns(expected_ticks);
+  BOOST_REQUIRE_LE(measured_ns, expected_ns * (1. + 1. / 32.));
+  BOOST_REQUIRE_GE(measured_ns, expected_ns * (1. - 1. / 32.));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LatencyHistogram_test)
+
+BOOST_AUTO_TEST_CASE(EmptySummary)
+{
+  LatencyHistogram histogram;
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 0);
+  BOOST_REQUIRE_EQUAL(summary.p50_ns, 0.);
+  BOOST_REQUIRE_EQUAL(summary.max_ns, 0.);
+}
+
+BOOST_AUTO_TEST_CASE(KeepsPrecisionOverTheRange)
+{
+  for (uint64_t ticks : { 3ULL, 31ULL, 100ULL, 12345ULL, 987654321ULL, 1ULL << 40 }) { // NOLINT(build/unsigned)
+    LatencyHistogram histogram;
+    histogram.record(ticks);
+    auto summary = histogram.take();
+    BOOST_REQUIRE_EQUAL(summary.count, 1);
+    require_close(summary.p50_ns, ticks);
+    require_close(summary.p999_ns, ticks);
+    BOOST_REQUIRE_EQUAL(summary.max_ns, TscClock::to_ns(ticks));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PercentilesOfAUniformDistribution)
+{
+  LatencyHistogram histogram;
+  for (uint64_t ticks = 1; ticks <= 100000; ++ticks) { // NOLINT(build/unsigned)
+    histogram.record(ticks);
+  }
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 100000);
+  require_close(summary.p50_ns, 50000);
+  require_close(summary.p90_ns, 90000);
+  require_close(summary.p99_ns, 99000);
+  require_close(summary.p999_ns, 99900);
+  BOOST_REQUIRE_EQUAL(summary.max_ns, TscClock::to_ns(100000));
+}
+
+BOOST_AUTO_TEST_CASE(TakeStartsANewInterval)
+{
+  LatencyHistogram histogram;
+  histogram.record(1000000);
+  histogram.take();
+  histogram.record(100);
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 1);
+  require_close(summary.p50_ns, 100);
+  BOOST_REQUIRE_EQUAL(summary.max_ns, TscClock::to_ns(100));
+  BOOST_REQUIRE_EQUAL(histogram.take().count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RecordsFromSeveralThreads)
+{
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 4; ++t) { // NOLINT(build/unsigned)
+    threads.emplace_back([&histogram, t]() {
+      for (uint64_t i = 0; i < 100000; ++i) { // NOLINT(build/unsigned)
+        histogram.record(1 + (i + t) % 1000);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 400000);
+  BOOST_REQUIRE_EQUAL(summary.max_ns, TscClock::to_ns(1000));
+}
+
+BOOST_AUTO_TEST_CASE(TimerRecordsItsScope)
+{
+  LatencyHistogram histogram;
+  {
+    LatencyTimer timer(histogram);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 1);
+  BOOST_REQUIRE_GE(summary.max_ns, 2e6 * (1. - 1. / 32.));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
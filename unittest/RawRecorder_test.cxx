@@ -0,0 +1,317 @@
+/**
+ * @file RawRecorder_test.cxx Unit tests of RawRecorder: recordings identical
+ * to the recorded elements with both engines, aligned writes and the flush of
+ * the unaligned tail, io_uring submissions the kernel refuses, the recording
+ * window, and compressed frames.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/RawRecorder.hpp"
+
+#define BOOST_TEST_MODULE RawRecorder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+constexpr std::size_t s_element_size = 1000; // Not a multiple of the O_DIRECT alignment
+
+std::string
+test_file(const std::string& name)
+{
+  return (std::filesystem::temp_directory_path() / ("RawRecorder_test_" + std::to_string(getpid()) + "_" + name))
+    .string();
+}
+
+std::vector<char>
+read_file(const std::string& filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Compressible, and different in every 4 kB so that blocks out of order show
+std::vector<char>
+make_data(std::size_t size)
+{
+  std::vector<char> data(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>((i / 4096) ^ (i % 13));
+  }
+  return data;
+}
+
+RawRecorderConf
+make_conf(const std::string& filename, RecorderEngine engine)
+{
+  RawRecorderConf conf;
+  conf.filename = filename;
+  conf.block_size = 4 * 4096;
+  conf.blocks = 4;
+  conf.engine = engine;
+  return conf;
+}
+
+// Record every element, waiting for the writers whenever one had to be dropped
+void
+record_all(RawRecorder& recorder, const std::vector<char>& data)
+{
+  for (std::size_t offset = 0; offset < data.size(); offset += s_element_size) {
+    const std::size_t size = std::min(s_element_size, data.size() - offset);
+    for (;;) {
+      const uint64_t dropped = recorder.get_stats().dropped_records; // NOLINT(build/unsigned)
+      recorder.record(data.data() + offset, size);
+      if (recorder.get_stats().dropped_records == dropped) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+}
+
+// The raw data of a compressed recording, its blocks put back in sequence order
+std::vector<char>
+decompress_file(const std::string& filename)
+{
+  const auto file = read_file(filename);
+  std::map<uint64_t, std::vector<char>> blocks; // NOLINT(build/unsigned)
+  std::size_t offset = 0;
+  while (offset < file.size()) {
+    BOOST_REQUIRE_EQUAL(offset % 4096, 0);
+    BOOST_REQUIRE_LE(offset + sizeof(RecordedFrameHeader), file.size());
+    RecordedFrameHeader header;
+    std::memcpy(&header, file.data() + offset, sizeof(header));
+    BOOST_REQUIRE_EQUAL(header.magic, RecordedFrameHeader::s_magic);
+    BOOST_REQUIRE_EQUAL(header.frame_size % 4096, 0);
+    BOOST_REQUIRE_LE(sizeof(header) + header.compressed_size, header.frame_size);
+    const char* payload = file.data() + offset + sizeof(header);
+    std::vector<char> raw(header.raw_size);
+    std::size_t size = 0;
+    switch (static_cast<RecorderCompression>(header.compression)) {
+      case RecorderCompression::none:
+        std::memcpy(raw.data(), payload, header.compressed_size);
+        size = header.compressed_size;
+        break;
+#if READOUTMODULES_HAVE_LZ4
+      case RecorderCompression::lz4:
+        size = static_cast<std::size_t>(LZ4_decompress_safe(
+          payload, raw.data(), static_cast<int>(header.compressed_size), static_cast<int>(raw.size())));
+        break;
+#endif
+#if READOUTMODULES_HAVE_ZSTD
+      case RecorderCompression::zstd:
+        size = ZSTD_decompress(raw.data(), raw.size(), payload, header.compressed_size);
+        break;
+#endif
+      default:
+        BOOST_FAIL("Unexpected compression " << header.compression);
+    }
+    BOOST_REQUIRE_EQUAL(size, header.raw_size);
+    BOOST_REQUIRE(blocks.emplace(header.sequence, std::move(raw)).second);
+    offset += header.frame_size;
+  }
+  std::vector<char> data;
+  uint64_t sequence = 0; // NOLINT(build/unsigned)
+  for (const auto& block : blocks) {
+    BOOST_REQUIRE_EQUAL(block.first, sequence++);
+    data.insert(data.end(), block.second.begin(), block.second.end());
+  }
+  return data;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(RawRecorder_test)
+
+BOOST_AUTO_TEST_CASE(RejectsBadConfigurations)
+{
+  RawRecorder recorder;
+  auto conf = make_conf(test_file("bad.bin"), RecorderEngine::threads);
+  conf.block_size = 3 * 4096 + 1;
+  BOOST_REQUIRE_THROW(recorder.open(conf), GenericConfigurationError);
+  conf.block_size = 4096;
+  BOOST_REQUIRE_THROW(recorder.open(conf), GenericConfigurationError);
+  conf = make_conf(test_file("bad.bin"), RecorderEngine::threads);
+  conf.blocks = 1;
+  BOOST_REQUIRE_THROW(recorder.open(conf), GenericConfigurationError);
+}
+
+BOOST_AUTO_TEST_CASE(RecordsEveryElementInOrder)
+{
+  const auto data = make_data(2 * 1024 * 1024 + 123);
+  for (auto engine : { RecorderEngine::io_uring, RecorderEngine::threads }) {
+    const auto filename = test_file("order.bin");
+    RawRecorder recorder;
+    recorder.open(make_conf(filename, engine));
+    BOOST_TEST_MESSAGE("Recording with " << (recorder.get_engine() == RecorderEngine::io_uring ? "io_uring" : "threads")
+                                         << (recorder.is_direct_io() ? " and O_DIRECT" : ""));
+    recorder.start(std::chrono::hours(1));
+    record_all(recorder, data);
+    recorder.close();
+
+    // Blocks were reused many times over, and O_DIRECT refused none of the writes
+    const auto stats = recorder.get_stats();
+    BOOST_REQUIRE_EQUAL(stats.recorded_bytes, data.size());
+    BOOST_REQUIRE_EQUAL(stats.written_bytes, data.size());
+    BOOST_REQUIRE_EQUAL(stats.write_errors, 0);
+    BOOST_REQUIRE_GT(stats.blocks_written, 100);
+    BOOST_REQUIRE(read_file(filename) == data);
+    std::remove(filename.c_str());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WritesOnceTheBlocksWhoseSubmissionFailed)
+{
+  const auto filename = test_file("refused.bin");
+  RawRecorder recorder;
+  recorder.open(make_conf(filename, RecorderEngine::io_uring));
+  if (recorder.get_engine() != RecorderEngine::io_uring) {
+    BOOST_TEST_MESSAGE("io_uring not available, nothing to test");
+    recorder.close();
+    std::remove(filename.c_str());
+    return;
+  }
+  recorder.start(std::chrono::hours(1));
+  // Now and then the kernel refuses a submission: the block must go out synchronously, and only once
+  const auto data = make_data(1024 * 1024 + 321);
+  for (std::size_t offset = 0; offset < data.size(); offset += 64 * s_element_size) {
+    IoUring::inject_submit_failures(2);
+    const auto end = data.begin() + static_cast<std::ptrdiff_t>(std::min(data.size(), offset + 64 * s_element_size));
+    record_all(recorder, std::vector<char>(data.begin() + static_cast<std::ptrdiff_t>(offset), end));
+  }
+  recorder.close();
+  IoUring::inject_submit_failures(0);
+
+  const auto stats = recorder.get_stats();
+  BOOST_REQUIRE_EQUAL(stats.written_bytes, data.size());
+  BOOST_REQUIRE_EQUAL(stats.write_errors, 0);
+  BOOST_REQUIRE(read_file(filename) == data);
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(DropsNothingWhileABlockIsFree)
+{
+  const auto filename = test_file("free.bin");
+  auto conf = make_conf(filename, RecorderEngine::threads);
+  conf.blocks = 64;
+  RawRecorder recorder;
+  recorder.open(conf);
+  recorder.start(std::chrono::hours(1));
+  // Less than the blocks can hold even if no writer runs: each one writes out at least block_size - 4096 bytes
+  const auto data = make_data(conf.blocks / 2 * conf.block_size);
+  for (std::size_t offset = 0; offset < data.size(); offset += s_element_size) {
+    recorder.record(data.data() + offset, std::min(s_element_size, data.size() - offset));
+  }
+  recorder.close();
+  BOOST_REQUIRE_EQUAL(recorder.get_stats().dropped_records, 0);
+  BOOST_REQUIRE(read_file(filename) == data);
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(WritesAlignedBlocksAndFlushesTheTail)
+{
+  const auto filename = test_file("tail.bin");
+  RawRecorder recorder;
+  recorder.open(make_conf(filename, RecorderEngine::threads));
+  recorder.start(std::chrono::hours(1));
+  const auto data = make_data(3 * 4096 + 3 * s_element_size);
+  record_all(recorder, data);
+  recorder.stop();
+
+  // Stopped, only the aligned part of the block goes out; the rest waits for more data or close()
+  const uint64_t aligned = 3 * 4096; // NOLINT(build/unsigned)
+  for (int i = 0; i < 1000 && recorder.get_stats().written_bytes < aligned; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_REQUIRE_EQUAL(recorder.get_stats().written_bytes, aligned);
+  BOOST_REQUIRE_EQUAL(std::filesystem::file_size(filename), aligned);
+
+  recorder.close();
+  BOOST_REQUIRE_EQUAL(recorder.get_stats().written_bytes, data.size());
+  BOOST_REQUIRE_EQUAL(recorder.get_stats().write_errors, 0);
+  BOOST_REQUIRE(read_file(filename) == data);
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(RecordsOnlyWhileActive)
+{
+  const auto filename = test_file("window.bin");
+  RawRecorder recorder;
+  recorder.open(make_conf(filename, RecorderEngine::threads));
+  const auto before = make_data(10 * s_element_size);
+  record_all(recorder, before);
+  BOOST_REQUIRE(!recorder.is_active());
+
+  recorder.start(std::chrono::hours(1));
+  BOOST_REQUIRE(recorder.is_active());
+  const auto data = make_data(7 * s_element_size);
+  record_all(recorder, data);
+  recorder.stop();
+  record_all(recorder, before);
+  recorder.close();
+
+  BOOST_REQUIRE_EQUAL(recorder.get_stats().recorded_bytes, data.size());
+  BOOST_REQUIRE(read_file(filename) == data);
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(EndsAtTheDeadline)
+{
+  const auto filename = test_file("deadline.bin");
+  RawRecorder recorder;
+  recorder.open(make_conf(filename, RecorderEngine::threads));
+  recorder.start(std::chrono::milliseconds(1));
+  for (int i = 0; i < 1000 && recorder.is_active(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_REQUIRE(!recorder.is_active());
+  recorder.close();
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(WritesCompressedFrames)
+{
+  const auto data = make_data(512 * 1024 + 77);
+  for (auto compression : { RecorderCompression::lz4, RecorderCompression::zstd }) {
+    const auto filename = test_file("compressed.bin");
+    auto conf = make_conf(filename, RecorderEngine::threads);
+    conf.compression = compression;
+    RawRecorder recorder;
+    if (!detail::compression_available(compression)) {
+      BOOST_REQUIRE_THROW(recorder.open(conf), GenericConfigurationError);
+      continue;
+    }
+    recorder.open(conf);
+    recorder.start(std::chrono::hours(1));
+    record_all(recorder, data);
+    recorder.close();
+
+    const auto stats = recorder.get_stats();
+    BOOST_REQUIRE_EQUAL(stats.write_errors, 0);
+    BOOST_REQUIRE_LT(stats.written_bytes, data.size());
+    BOOST_REQUIRE_EQUAL(stats.written_bytes, std::filesystem::file_size(filename));
+    BOOST_REQUIRE(decompress_file(filename) == data);
+    std::remove(filename.c_str());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,256 @@
+/**
+ * @file SaturationRateFinder_test.cxx Unit tests of the search steps of
+ * SaturationRateFinder and of a whole search over links whose loss threshold
+ * is known.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/SaturationRateFinder.hpp"
+
+#define BOOST_TEST_MODULE SaturationRateFinder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using namespace dunedaq::readoutmodules;
+
+namespace {
+
+// Sends exactly at the rate asked, and fails to send at every look above loss_scale times its nominal rate
+class FakeLink : public SourceEmulatorLinkConcept
+{
+public:
+  FakeLink(double nominal_rate_khz, double loss_scale)
+    : m_nominal_rate_khz(nominal_rate_khz)
+    , m_loss_scale(loss_scale)
+    , m_last(std::chrono::steady_clock::now())
+  {}
+
+  std::string get_source_filename(
+    const dunedaq::readoutlibs::sourceemulatorconfig::LinkConfiguration& /*link_conf*/) const override
+  {
+    return "";
+  }
+  void set_source_buffer(std::shared_ptr<const MappedSourceBuffer> /*buffer*/) override {}
+  void set_replay_clock(ReplayClock& /*clock*/) override {}
+  void set_engine_driven(bool /*engine_driven*/) override {}
+  double produce_next() override { return 0.; }
+  double get_nominal_rate_khz() const override { return m_nominal_rate_khz; }
+  void set_rate_scale(double scale) override
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    advance();
+    m_scale = scale;
+  }
+  EmulatedLinkHealth get_link_health() const override
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    advance();
+    m_health.send_failures += (m_scale > m_loss_scale) ? 1 : 0;
+    return m_health;
+  }
+
+  void init(const nlohmann::json& /*args*/) override {}
+  void set_sender(const std::string& /*conn_name*/) override {}
+  void conf(const nlohmann::json& /*args*/, const nlohmann::json& /*link_conf*/) override {}
+  bool is_configured() override { return true; }
+  void scrap(const nlohmann::json& /*args*/) override {}
+  void start(const nlohmann::json& /*args*/) override {}
+  void stop(const nlohmann::json& /*args*/) override {}
+  void get_info(dunedaq::opmonlib::InfoCollector& /*ci*/, int /*level*/) override {}
+
+  double get_scale() const
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_scale;
+  }
+
+private:
+  // Count what was sent since the last look, at the scale that ran
+  void advance() const
+  {
+    const auto now = std::chrono::steady_clock::now();
+    m_sent += std::chrono::duration<double, std::milli>(now - m_last).count() * m_nominal_rate_khz * m_scale;
+    m_last = now;
+    m_health.sent = static_cast<uint64_t>(m_sent); // NOLINT(build/unsigned)
+  }
+
+  const double m_nominal_rate_khz;
+  const double m_loss_scale;
+  mutable std::mutex m_mutex;
+  double m_scale = 1.;
+  mutable double m_sent = 0.;
+  mutable std::chrono::steady_clock::time_point m_last;
+  mutable EmulatedLinkHealth m_health;
+};
+
+// The handler of a link, dropping at every look above loss_scale times the nominal rate of the link
+class FakeHandler : public LossReportingReadoutConcept
+{
+public:
+  FakeHandler(const FakeLink& link, double loss_scale)
+    : m_link(link)
+    , m_loss_scale(loss_scale)
+  {}
+
+  ReadoutLossCounters get_loss_counters() const override
+  {
+    m_counters.dropped += (m_link.get_scale() > m_loss_scale) ? 1 : 0;
+    return m_counters;
+  }
+
+private:
+  const FakeLink& m_link;
+  const double m_loss_scale;
+  mutable ReadoutLossCounters m_counters;
+};
+
+// Step one link until it converged, lossless below loss_scale; returns the number of windows
+int
+search(const SaturationSearchConf& conf, SaturationLinkResult& link, double loss_scale)
+{
+  double lossy_scale = 0.;
+  link.current_scale = conf.start_scale;
+  int steps = 0;
+  while (!link.converged && steps < 100) {
+    ++steps;
+    SaturationRateFinder::search_step(conf, link, lossy_scale, link.current_scale <= loss_scale, link.current_scale);
+  }
+  return steps;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SaturationRateFinder_test)
+
+BOOST_AUTO_TEST_CASE(RampsUpByPowersOfTwo)
+{
+  SaturationSearchConf conf;
+  SaturationLinkResult link;
+  link.current_scale = 1.;
+  double lossy_scale = 0.;
+
+  SaturationRateFinder::search_step(conf, link, lossy_scale, true, 10.);
+  BOOST_REQUIRE_EQUAL(link.scale, 1.);
+  BOOST_REQUIRE_EQUAL(link.rate_khz, 10.);
+  BOOST_REQUIRE_EQUAL(link.current_scale, 2.);
+  BOOST_REQUIRE(!link.converged);
+
+  SaturationRateFinder::search_step(conf, link, lossy_scale, true, 20.);
+  BOOST_REQUIRE_EQUAL(link.current_scale, 4.);
+  BOOST_REQUIRE_EQUAL(lossy_scale, 0.);
+}
+
+BOOST_AUTO_TEST_CASE(RampsDownByPowersOfTwo)
+{
+  SaturationSearchConf conf;
+  SaturationLinkResult link;
+  link.current_scale = 1.;
+  double lossy_scale = 0.;
+
+  SaturationRateFinder::search_step(conf, link, lossy_scale, false, 9.);
+  BOOST_REQUIRE_EQUAL(lossy_scale, 1.);
+  BOOST_REQUIRE_EQUAL(link.scale, 0.);
+  BOOST_REQUIRE_EQUAL(link.current_scale, 0.5);
+  BOOST_REQUIRE(!link.converged);
+}
+
+BOOST_AUTO_TEST_CASE(BisectsOnceBracketed)
+{
+  SaturationSearchConf conf;
+  SaturationLinkResult link;
+  link.current_scale = 2.;
+  link.scale = 1.;
+  double lossy_scale = 0.;
+
+  // Lossy at 2 with 1 lossless: try halfway
+  SaturationRateFinder::search_step(conf, link, lossy_scale, false, 15.);
+  BOOST_REQUIRE_EQUAL(lossy_scale, 2.);
+  BOOST_REQUIRE_EQUAL(link.current_scale, 1.5);
+
+  // Lossless at 1.5: the lower edge moves up
+  SaturationRateFinder::search_step(conf, link, lossy_scale, true, 15.);
+  BOOST_REQUIRE_EQUAL(link.scale, 1.5);
+  BOOST_REQUIRE_EQUAL(link.rate_khz, 15.);
+  BOOST_REQUIRE_EQUAL(link.current_scale, 1.75);
+  BOOST_REQUIRE(!link.converged);
+}
+
+BOOST_AUTO_TEST_CASE(ConvergesWithinPrecision)
+{
+  SaturationSearchConf conf;
+  for (double loss_scale : { 0.3, 1., 3.7, 42. }) {
+    SaturationLinkResult link;
+    int steps = search(conf, link, loss_scale);
+    BOOST_TEST_MESSAGE("Lossless up to " << loss_scale << ": found " << link.scale << " in " << steps << " steps");
+    BOOST_REQUIRE(link.converged);
+    BOOST_REQUIRE_LE(link.scale, loss_scale);
+    BOOST_REQUIRE_GE(link.scale, loss_scale * (1. - 2. * conf.precision));
+    BOOST_REQUIRE_EQUAL(link.current_scale, link.scale);
+    BOOST_REQUIRE_LT(steps, 20);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StopsAtTheLimits)
+{
+  SaturationSearchConf conf;
+
+  SaturationLinkResult fast;
+  search(conf, fast, 1000.);
+  BOOST_REQUIRE(fast.converged);
+  BOOST_REQUIRE_EQUAL(fast.scale, conf.max_scale);
+
+  // Lossy even at the minimum scale: it converges with no lossless rate and keeps running at the minimum
+  SaturationLinkResult slow;
+  search(conf, slow, 0.);
+  BOOST_REQUIRE(slow.converged);
+  BOOST_REQUIRE_EQUAL(slow.scale, 0.);
+  BOOST_REQUIRE_EQUAL(slow.current_scale, conf.min_scale);
+}
+
+BOOST_AUTO_TEST_CASE(FindsTheRateOfEveryLink)
+{
+  SaturationSearchConf conf;
+  conf.settle = std::chrono::milliseconds(1);
+  conf.window = std::chrono::milliseconds(20);
+
+  // The first link loses at its output, the second one in its handler
+  FakeLink output_bound(10., 3.7);
+  FakeLink handler_bound(10., 1000.);
+  FakeHandler handler(handler_bound, 1.2);
+  LinkLossRegistry::get().publish("handler_bound_raw", &handler);
+
+  SaturationRateFinder finder({ { "output_bound", "output_bound_raw", &output_bound },
+                                { "handler_bound", "handler_bound_raw", &handler_bound } },
+                              conf);
+  finder.start();
+  SaturationSearchResult result;
+  for (int i = 0; i < 500; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    result = finder.get_result();
+    if (result.state == SaturationSearchState::done || result.state == SaturationSearchState::failed) {
+      break;
+    }
+  }
+  finder.stop();
+  LinkLossRegistry::get().withdraw("handler_bound_raw");
+
+  BOOST_REQUIRE(result.state == SaturationSearchState::done);
+  BOOST_REQUIRE_EQUAL(result.links.size(), 2);
+  BOOST_REQUIRE_LE(result.links[0].scale, 3.7);
+  BOOST_REQUIRE_GE(result.links[0].scale, 3.7 * (1. - 2. * conf.precision));
+  BOOST_REQUIRE(!result.links[0].handler_losses_observed);
+  BOOST_REQUIRE(result.links[1].handler_losses_observed);
+  BOOST_REQUIRE_LE(result.links[1].scale, 1.2);
+  BOOST_REQUIRE_GE(result.links[1].scale, 1.2 * (1. - 2. * conf.precision));
+  BOOST_REQUIRE_EQUAL(result.nominal_rate_khz, 20.);
+  BOOST_REQUIRE_GT(result.rate_khz, 0.);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
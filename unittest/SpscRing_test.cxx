@@ -0,0 +1,169 @@
+/**
+ * @file SpscRing_test.cxx Unit tests of SpscRing: capacity rounding, full and
+ * empty rings, occupancy, and the order of the elements passed from one
+ * thread to another; the registry of the in-process rings.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "readoutmodules/utils/InProcessRing.hpp"
+#include "readoutmodules/utils/SpscRing.hpp"
+
+#define BOOST_TEST_MODULE SpscRing_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace dunedaq::readoutmodules;
+
+BOOST_AUTO_TEST_SUITE(SpscRing_test)
+
+BOOST_AUTO_TEST_CASE(RoundsCapacityUp)
+{
+  BOOST_REQUIRE_EQUAL(SpscRing<int>::rounded_capacity(1), 1);
+  BOOST_REQUIRE_EQUAL(SpscRing<int>::rounded_capacity(16), 16);
+  BOOST_REQUIRE_EQUAL(SpscRing<int>::rounded_capacity(17), 32);
+  SpscRing<int> ring(1000);
+  BOOST_REQUIRE_EQUAL(ring.capacity(), 1024);
+}
+
+BOOST_AUTO_TEST_CASE(FillsAndDrains)
+{
+  SpscRing<int> ring(4);
+  BOOST_REQUIRE(ring.read_slot() == nullptr);
+  BOOST_REQUIRE_EQUAL(ring.occupancy(), 0);
+
+  for (int i = 0; i < 4; ++i) {
+    int* slot = ring.write_slot();
+    BOOST_REQUIRE(slot != nullptr);
+    *slot = i;
+    ring.commit();
+    BOOST_REQUIRE_EQUAL(ring.occupancy(), i + 1);
+  }
+  BOOST_REQUIRE(ring.write_slot() == nullptr);
+
+  for (int i = 0; i < 4; ++i) {
+    int* slot = ring.read_slot();
+    BOOST_REQUIRE(slot != nullptr);
+    BOOST_REQUIRE_EQUAL(*slot, i);
+    ring.release();
+  }
+  BOOST_REQUIRE(ring.read_slot() == nullptr);
+  BOOST_REQUIRE_EQUAL(ring.occupancy(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(WrapsAround)
+{
+  SpscRing<int> ring(4);
+  for (int i = 0; i < 100; ++i) {
+    *ring.write_slot() = i;
+    ring.commit();
+    *ring.write_slot() = -i;
+    ring.commit();
+    BOOST_REQUIRE_EQUAL(*ring.read_slot(), i);
+    ring.release();
+    BOOST_REQUIRE_EQUAL(*ring.read_slot(), -i);
+    ring.release();
+  }
+  BOOST_REQUIRE_EQUAL(ring.occupancy(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(PassesElementsInOrder)
+{
+  const uint64_t elements = 1000000; // NOLINT(build/unsigned)
+  SpscRing<uint64_t> ring(64);       // NOLINT(build/unsigned)
+  std::atomic<bool> in_order{ true };
+  std::atomic<bool> in_bounds{ true };
+
+  std::thread consumer([&]() {
+    for (uint64_t expected = 0; expected < elements;) { // NOLINT(build/unsigned)
+      const uint64_t* slot = ring.read_slot();          // NOLINT(build/unsigned)
+      if (slot == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      in_order = in_order && *slot == expected;
+      ++expected;
+      ring.release();
+    }
+  });
+  // Read from a third thread while both sides move
+  std::thread observer([&]() {
+    for (int i = 0; i < 100000; ++i) {
+      in_bounds = in_bounds && ring.occupancy() <= ring.capacity();
+    }
+  });
+  for (uint64_t i = 0; i < elements;) { // NOLINT(build/unsigned)
+    uint64_t* slot = ring.write_slot(); // NOLINT(build/unsigned)
+    if (slot == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    *slot = i++;
+    ring.commit();
+  }
+  consumer.join();
+  observer.join();
+
+  BOOST_REQUIRE(in_order);
+  BOOST_REQUIRE(in_bounds);
+  BOOST_REQUIRE_EQUAL(ring.occupancy(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(RingSlotsFollowTheBatchSize)
+{
+  BOOST_REQUIRE_EQUAL(ring_slots(8192, 1), 8192);
+  BOOST_REQUIRE_EQUAL(ring_slots(8192, 16), 512);
+  BOOST_REQUIRE_EQUAL(ring_slots(8192, 64), 128);
+  BOOST_REQUIRE_EQUAL(ring_slots(100, 64), 16);
+  BOOST_REQUIRE_EQUAL(ring_slots(100, 0), 100);
+}
+
+BOOST_AUTO_TEST_CASE(RegistrySharesAndForgetsRings)
+{
+  auto& registry = InProcessRingRegistry::get();
+  auto producer = registry.acquire<int>("spscring_test", 16);
+  auto consumer = registry.acquire<int>("spscring_test", 16);
+  BOOST_REQUIRE(producer == consumer);
+  BOOST_REQUIRE_THROW(registry.acquire<int>("spscring_test", 64), dunedaq::readoutmodules::GenericConfigurationError);
+
+  // Once both sides released it, the next acquire may pick another capacity
+  producer.reset();
+  consumer.reset();
+  auto resized = registry.acquire<int>("spscring_test", 64);
+  BOOST_REQUIRE_EQUAL(resized->capacity(), 64);
+}
+
+BOOST_AUTO_TEST_CASE(RegistrySurvivesRefusalsRacingReleases)
+{
+  // A refused acquire may hold the last reference of a ring its peer just released
+  auto& registry = InProcessRingRegistry::get();
+  std::atomic<bool> done{ false };
+  std::thread peer([&]() {
+    while (!done) {
+      try {
+        registry.acquire<int>("spscring_race", 16).reset();
+      } catch (const dunedaq::readoutmodules::GenericConfigurationError&) {
+      }
+    }
+  });
+  std::size_t refused = 0;
+  for (int i = 0; i < 200000; ++i) {
+    try {
+      registry.acquire<int>("spscring_race", 64);
+    } catch (const dunedaq::readoutmodules::GenericConfigurationError&) {
+      ++refused;
+    }
+  }
+  done = true;
+  peer.join();
+  BOOST_TEST_MESSAGE(refused << " acquires refused");
+  // Neither side holds the ring any more, its entry is gone
+  BOOST_REQUIRE_EQUAL(registry.acquire<int>("spscring_race", 32)->capacity(), 32);
+}
+
+BOOST_AUTO_TEST_SUITE_END()